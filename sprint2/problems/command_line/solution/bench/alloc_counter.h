@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+
+namespace bench {
+
+    // Число вызовов глобального operator new с начала работы. Замена operator new действует на весь исполняемый
+    // файл бенчмарков, но остальным бенчмаркам она стоит только одного атомарного инкремента
+    uint64_t Allocations() noexcept;
+
+} //namespace bench
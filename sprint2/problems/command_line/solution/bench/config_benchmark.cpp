@@ -0,0 +1,140 @@
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "../src/json_loader.h"
+#include "../src/json_writer.h"
+
+namespace {
+
+    using namespace std::literals;
+    namespace fs = std::filesystem;
+    namespace pt = boost::property_tree;
+
+    constexpr uint64_t ROADS_PER_MAP = 16;
+    constexpr uint64_t BUILDINGS_PER_MAP = 4;
+    constexpr uint64_t OFFICES_PER_MAP = 2;
+
+    // Конфиг из count карт: у каждой решётка дорог, несколько зданий и офисов, у каждой второй своя скорость собак
+    std::string MakeConfig(size_t count) {
+        std::string text;
+        util::JsonWriter writer{text};
+        writer.BeginObject().Key("defaultDogSpeed"sv).Number(3.0).Key("maps"sv).BeginArray();
+        for (uint64_t m = 0; m < count; ++m) {
+            writer.BeginObject()
+                .Key("id"sv).String("map"s + std::to_string(m))
+                .Key("name"sv).String("Map "s + std::to_string(m));
+            if (m % 2 == 0) {
+                writer.Key("dogSpeed"sv).Number(4.5);
+            }
+            writer.Key("roads"sv).BeginArray();
+            for (uint64_t r = 0; r < ROADS_PER_MAP; ++r) {
+                writer.BeginObject().Key("x0"sv).Number(r * 10).Key("y0"sv).Number(r * 10)
+                    .Key(r % 2 ? "y1"sv : "x1"sv).Number(r * 10 + 40).EndObject();
+            }
+            writer.EndArray().Key("buildings"sv).BeginArray();
+            for (uint64_t b = 0; b < BUILDINGS_PER_MAP; ++b) {
+                writer.BeginObject().Key("x"sv).Number(b * 20 + 5).Key("y"sv).Number(b * 20 + 5)
+                    .Key("w"sv).Number(uint64_t{10}).Key("h"sv).Number(uint64_t{10}).EndObject();
+            }
+            writer.EndArray().Key("offices"sv).BeginArray();
+            for (uint64_t o = 0; o < OFFICES_PER_MAP; ++o) {
+                writer.BeginObject().Key("id"sv).String("o"s + std::to_string(o))
+                    .Key("x"sv).Number(o * 40).Key("y"sv).Number(o * 40)
+                    .Key("offsetX"sv).Number(uint64_t{5}).Key("offsetY"sv).Number(uint64_t{0}).EndObject();
+            }
+            writer.EndArray().EndObject();
+        }
+        writer.EndArray().EndObject();
+        return text;
+    }
+
+    // Временный файл конфига на время одного бенчмарка
+    class ConfigFile {
+    public:
+        explicit ConfigFile(size_t count)
+            : path_(fs::temp_directory_path() / ("game_server_bench_"s + std::to_string(count) + "_maps.json"s)) {
+            const std::string text = MakeConfig(count);
+            text_size_ = text.size();
+            std::ofstream(path_, std::ios::binary) << text;
+        }
+        ~ConfigFile() {
+            std::error_code ec;
+            fs::remove(path_, ec);
+        }
+        const fs::path& Path() const noexcept {
+            return path_;
+        }
+        size_t Size() const noexcept {
+            return text_size_;
+        }
+
+    private:
+        fs::path path_;
+        size_t text_size_ = 0;
+    };
+
+    // Прежний загрузчик на boost::property_tree: поддеревья копируются, карты собираются в одном потоке
+    model::Game LoadGamePtree(const fs::path& path) {
+        pt::ptree root;
+        pt::read_json(path.string(), root);
+        model::Game game;
+        const auto def_dog_speed = root.get<double>("defaultDogSpeed");
+        game.SetDefaultDogSpeed(def_dog_speed);
+        pt::ptree jmaps = root.get_child("maps");
+        for (auto& [_, jmap] : jmaps) {
+            model::Map map(model::Map::Id{jmap.get<std::string>("id")}, jmap.get<std::string>("name"),
+                jmap.get<double>("dogSpeed", def_dog_speed));
+            pt::ptree jroads = jmap.get_child("roads");
+            for (auto& [_, jroad] : jroads) {
+                const model::Point start{.x = jroad.get<int>("x0"), .y = jroad.get<int>("y0")};
+                if (auto y1 = jroad.get_optional<int>("y1")) {
+                    map.AddRoad(model::Road(model::Road::VERTICAL, start, *y1, map.GetRoadOffset()));
+                }
+                else {
+                    map.AddRoad(model::Road(model::Road::HORIZONTAL, start, jroad.get<int>("x1"), map.GetRoadOffset()));
+                }
+            }
+            pt::ptree jbuildings = jmap.get_child("buildings");
+            for (auto& [_, jb] : jbuildings) {
+                map.AddBuilding(model::Building({.position = {.x = jb.get<int>("x"), .y = jb.get<int>("y")},
+                    .size = {.width = jb.get<int>("w"), .height = jb.get<int>("h")}}));
+            }
+            pt::ptree joffices = jmap.get_child("offices");
+            for (auto& [_, jo] : joffices) {
+                map.AddOffice(model::Office(model::Office::Id{jo.get<std::string>("id")},
+                    {.x = jo.get<int>("x"), .y = jo.get<int>("y")}, {.dx = jo.get<int>("offsetX"), .dy = jo.get<int>("offsetY")}));
+            }
+            game.AddMap(std::move(map));
+        }
+        return game;
+    }
+
+    // Время старта сервера на загрузке конфига: чтение файла, разбор и построение всех карт
+    template <typename Load>
+    void RunLoadGame(benchmark::State& state, Load&& load) {
+        const auto count = static_cast<size_t>(state.range(0));
+        const ConfigFile config{count};
+        for (auto _ : state) {
+            auto game = load(config.Path());
+            benchmark::DoNotOptimize(game.GetMaps().data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(config.Size()));
+    }
+
+    void BM_LoadGamePtree(benchmark::State& state) {
+        RunLoadGame(state, LoadGamePtree);
+    }
+
+    void BM_LoadGame(benchmark::State& state) {
+        RunLoadGame(state, json_loader::LoadGame);
+    }
+
+} //namespace
+
+BENCHMARK(BM_LoadGamePtree)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadGame)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,35 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "../src/model.h"
+
+namespace {
+
+    using namespace std::literals;
+
+    // Шторм входов: в сессию подряд входят N игроков, и перед каждым входом проверяется,
+    // нет ли уже собаки с такой кличкой. До индекса по кличкам FindDog был линейным, и весь шторм — O(N^2)
+    void BM_JoinStorm(benchmark::State& state) {
+        const auto count = static_cast<size_t>(state.range(0));
+        model::Map map{model::Map::Id{"bench"s}, "bench"s, 4.0};
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 100, map.GetRoadOffset()});
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back("player"s + std::to_string(i));
+        }
+        for (auto _ : state) {
+            model::GameSession session{&map, false};
+            for (const auto& name : names) {
+                if (session.FindDog(name) == nullptr) {
+                    benchmark::DoNotOptimize(session.AddDog(name));
+                }
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+} //namespace
+
+BENCHMARK(BM_JoinStorm)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <boost/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "../src/json_writer.h"
+#include "../src/state_feed.h"
+
+namespace {
+
+    namespace js = boost::json;
+    using namespace std::literals;
+
+    struct DogRow {
+        uint64_t id;
+        model::DPoint pos;
+        model::DSpeed speed;
+        model::Direction dir;
+    };
+
+    std::vector<DogRow> MakeDogs(size_t count) {
+        std::mt19937 gen{42};
+        std::uniform_real_distribution<double> pos_dist{0.0, 200.0};
+        std::vector<DogRow> dogs;
+        dogs.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            dogs.push_back({i, {pos_dist(gen), pos_dist(gen)}, {i % 2 ? 1.5 : 0.0, 0.0}, static_cast<model::Direction>(i % 4)});
+        }
+        return dogs;
+    }
+
+    js::array PutArray(double x, double y) {
+        js::array jarr;
+        jarr.emplace_back(x);
+        jarr.emplace_back(y);
+        return jarr;
+    }
+
+    // Прежний путь ответа /api/v1/game/state: дерево js::object и serialize
+    std::string SerializeDom(const std::vector<DogRow>& dogs) {
+        js::object state;
+        for (const auto& dog : dogs) {
+            js::object dog_param;
+            dog_param["pos"] = PutArray(dog.pos.x, dog.pos.y);
+            dog_param["speed"] = PutArray(dog.speed.x, dog.speed.y);
+            dog_param["dir"] = std::string(model::DirectionName(dog.dir));
+            state[std::to_string(dog.id)] = dog_param;
+        }
+        js::object players;
+        players["players"] = state;
+        return serialize(players);
+    }
+
+    std::string SerializeWriter(const std::vector<DogRow>& dogs) {
+        std::string body;
+        body.reserve(32 + dogs.size() * app::DOG_STATE_SIZE_HINT);
+        util::JsonWriter writer{body};
+        writer.BeginObject().Key("players"sv).BeginObject();
+        for (const auto& dog : dogs) {
+            writer.Key(dog.id);
+            app::WriteDogState(writer, dog.pos, dog.speed, dog.dir);
+        }
+        writer.EndObject().EndObject();
+        return body;
+    }
+
+    template <typename Serialize>
+    void RunStateBody(benchmark::State& state, Serialize&& serialize_body) {
+        const auto dogs = MakeDogs(static_cast<size_t>(state.range(0)));
+        int64_t bytes = 0;
+        const uint64_t allocations_before = bench::Allocations();
+        for (auto _ : state) {
+            auto body = serialize_body(dogs);
+            bytes += static_cast<int64_t>(body.size());
+            benchmark::DoNotOptimize(body.data());
+        }
+        const uint64_t allocated = bench::Allocations() - allocations_before;
+        state.SetBytesProcessed(bytes);
+        state.counters["allocs_per_response"] = static_cast<double>(allocated) / static_cast<double>(state.iterations());
+    }
+
+    void BM_StateBodyDom(benchmark::State& state) {
+        RunStateBody(state, SerializeDom);
+    }
+
+    void BM_StateBodyWriter(benchmark::State& state) {
+        RunStateBody(state, SerializeWriter);
+    }
+
+} //namespace
+
+BENCHMARK(BM_StateBodyDom)->Arg(10)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_StateBodyWriter)->Arg(10)->Arg(100)->Arg(1'000)->Arg(10'000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,127 @@
+#include <benchmark/benchmark.h>
+#include <array>
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "alloc_counter.h"
+#include "../src/request_handler/uri_api.h"
+
+namespace {
+
+    using namespace std::literals;
+
+    // Цели запросов в той пропорции, в которой их шлёт клиент игры: в основном опрос состояния и команды движения
+    constexpr std::array TARGETS{
+        "/api/v1/game/state"sv,
+        "/api/v1/game/state"sv,
+        "/api/v1/game/player/action"sv,
+        "/api/v1/game/player/action"sv,
+        "/api/v1/game/players"sv,
+        "/api/v1/maps/map1"sv,
+        "/API/V1/Maps/Town%20Center"sv,
+        "/api/v1/game/state/stream?token=6516861d89ebfff147bf2eb2b5153ae1"sv,
+    };
+
+    // Прежний разбор: sscanf на каждый %XX и новая строка на каждое раскодирование
+    std::string LegacyUriDecode(std::string_view src) {
+        std::string ret;
+        char ch;
+        int ii;
+        for (size_t i = 0; i < src.length(); i++) {
+            if (src[i] == '%') {
+                [[maybe_unused]] auto s = sscanf(src.substr(i + 1, 2).data(), "%x", &ii);
+                ch = static_cast<char>(ii);
+                ret += ch;
+                i = i + 2;
+            }
+            else if (src[i] == '+') {
+                ret += ' ';
+                i = i + 1;
+            }
+            else if (src[i] >= 'A' && src[i] <= 'Z') {
+                ret += src[i] - 'A' + 'a';
+            }
+            else {
+                ret += src[i];
+            }
+        }
+        return ret;
+    }
+
+    // Прежний путь запроса: цель раскодировалась для лога, затем в RequestHandler и ещё раз в UriData,
+    // а маршрут искался в unordered_map по строке пути
+    class LegacyRouter {
+    public:
+        LegacyRouter() {
+            for (const auto& entry : uri_api::ROUTES) {
+                routes_.emplace(std::string(entry.path), entry.route);
+            }
+        }
+
+        std::optional<uri_api::Route> Route(std::string_view raw_target) const {
+            const std::string logged = LegacyUriDecode(raw_target);
+            benchmark::DoNotOptimize(logged.data());
+            std::string target{raw_target};
+            target = LegacyUriDecode(target);
+            if (!(target.size() > Endpoint::API.size() && target.substr(0, Endpoint::API.size()) == Endpoint::API)) {
+                return std::nullopt;
+            }
+            std::string path = LegacyUriDecode(raw_target);
+            path = std::string(path.substr(0, path.find('?')));
+            if (path.starts_with(Endpoint::MAPS)) {
+                path = std::string{Endpoint::MAPS};
+            }
+            if (auto it = routes_.find(path); it != routes_.end()) {
+                return it->second;
+            }
+            return std::nullopt;
+        }
+
+    private:
+        std::unordered_map<std::string, uri_api::Route> routes_;
+    };
+
+    template <typename RouteFn>
+    void RunRouting(benchmark::State& state, RouteFn&& route) {
+        size_t next = 0;
+        const uint64_t allocations_before = bench::Allocations();
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(route(TARGETS[next]));
+            next = (next + 1) % TARGETS.size();
+        }
+        const uint64_t allocated = bench::Allocations() - allocations_before;
+        state.SetItemsProcessed(state.iterations());
+        state.counters["allocs_per_request"] = static_cast<double>(allocated) / static_cast<double>(state.iterations());
+    }
+
+    void BM_RouteTargetLegacy(benchmark::State& state) {
+        const LegacyRouter router;
+        RunRouting(state, [&router](std::string_view raw_target) {
+            return router.Route(raw_target);
+        });
+    }
+
+    // Как в сессии: цель раскодируется один раз в строку из арены запроса, дальше её разбирает RequestTarget
+    void BM_RouteTarget(benchmark::State& state) {
+        std::array<std::byte, 1024> arena_buffer;
+        std::pmr::monotonic_buffer_resource arena{arena_buffer.data(), arena_buffer.size()};
+        RunRouting(state, [&arena](std::string_view raw_target) {
+            std::optional<uri_api::Route> route;
+            {
+                std::pmr::string decoded{&arena};
+                http_server::UriDecode(raw_target, decoded);
+                const uri_api::RequestTarget target{decoded};
+                route = target.GetRoute();
+            }
+            arena.release();
+            return route;
+        });
+    }
+
+} //namespace
+
+BENCHMARK(BM_RouteTargetLegacy);
+BENCHMARK(BM_RouteTarget);
@@ -0,0 +1,80 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <vector>
+
+#include "../src/model.h"
+
+namespace {
+
+    using namespace std::literals;
+
+    constexpr model::Coord GRID_SIZE = 200;
+    constexpr model::Coord GRID_STEP = 10;
+
+    // Карта-решётка из горизонтальных и вертикальных дорог с шагом GRID_STEP
+    model::Map MakeGridMap() {
+        model::Map map{model::Map::Id{"bench"s}, "bench"s, 4.0};
+        for (model::Coord c = 0; c <= GRID_SIZE; c += GRID_STEP) {
+            map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, c}, GRID_SIZE, map.GetRoadOffset()});
+            map.AddRoad(model::Road{model::Road::VERTICAL, {c, 0}, GRID_SIZE, map.GetRoadOffset()});
+        }
+        return map;
+    }
+
+    void SendAllDogsMoving(model::GameSession& session, std::mt19937& gen) {
+        static constexpr model::Move MOVES[] = {model::Move::LEFT, model::Move::RIGHT, model::Move::UP, model::Move::DOWN};
+        std::uniform_int_distribution<size_t> move_dist{0, std::size(MOVES) - 1};
+        for (const auto& dog : session.GetDogs()) {
+            session.MoveDog(dog.GetId(), MOVES[move_dist(gen)]);
+        }
+    }
+
+    model::GameSession MakeSession(const model::Map& map, size_t dog_count, std::mt19937& gen) {
+        model::GameSession session{&map, false};
+        std::uniform_int_distribution<model::Coord> line_dist{0, GRID_SIZE / GRID_STEP};
+        std::uniform_real_distribution<double> pos_dist{0.0, static_cast<double>(GRID_SIZE)};
+        for (size_t i = 0; i < dog_count; ++i) {
+            auto* dog = session.AddDog("dog"s + std::to_string(i));
+            const double line = static_cast<double>(line_dist(gen) * GRID_STEP);
+            dog->SetPoint(i % 2 == 0 ? model::DPoint{pos_dist(gen), line} : model::DPoint{line, pos_dist(gen)});
+        }
+        return session;
+    }
+
+    // Полный тик сессии: интегрирование скоростей и ограничение перемещения дорогами.
+    // Собаки, упёршиеся в край дороги, останавливаются, поэтому перед каждым тиком им заново задаётся направление
+    void BM_Tick(benchmark::State& state) {
+        std::mt19937 gen{42};
+        const auto map = MakeGridMap();
+        auto session = MakeSession(map, static_cast<size_t>(state.range(0)), gen);
+        for (auto _ : state) {
+            state.PauseTiming();
+            SendAllDogsMoving(session, gen);
+            state.ResumeTiming();
+            session.Tick(50ms);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    // Только векторное ядро IntegrateMovement
+    void BM_IntegrateMovement(benchmark::State& state) {
+        std::mt19937 gen{42};
+        const auto map = MakeGridMap();
+        auto session = MakeSession(map, static_cast<size_t>(state.range(0)), gen);
+        SendAllDogsMoving(session, gen);
+        std::vector<model::DCoord> end_x(state.range(0));
+        std::vector<model::DCoord> end_y(state.range(0));
+        for (auto _ : state) {
+            model::IntegrateMovement(session.GetDogStates(), 50ms, end_x.data(), end_y.data());
+            benchmark::DoNotOptimize(end_x.data());
+            benchmark::DoNotOptimize(end_y.data());
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+} //namespace
+
+BENCHMARK(BM_Tick)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_IntegrateMovement)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,56 @@
+#!/usr/bin/env python3
+# Проверка памяти сервера на долгом keep-alive соединении: клиент шлёт запросы по одному (отправил, дождался
+# ответа, отправил следующий) и периодически снимает VmRSS процесса сервера из /proc/<pid>/status.
+# После прогрева память должна стоять на месте: арена каждого обмена освобождается вместе с ним.
+# Код возврата 1, если RSS вырос больше чем на --max-growth-kb.
+import argparse
+import socket
+import sys
+
+from pipeline import make_request, read_responses
+
+TARGETS = ["/api/v1/maps", "/api/v1/maps/map1", "/index.html"]
+
+
+def rss_kb(pid):
+    with open(f"/proc/{pid}/status") as status:
+        for line in status:
+            if line.startswith("VmRSS:"):
+                return int(line.split()[1])
+    raise RuntimeError("VmRSS not found")
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--pid", type=int, required=True, help="pid процесса сервера")
+    parser.add_argument("--requests", type=int, default=200000)
+    parser.add_argument("--samples", type=int, default=10, help="сколько раз снять RSS за прогон")
+    parser.add_argument("--warmup", type=int, default=10000, help="запросов до первого замера")
+    parser.add_argument("--max-growth-kb", type=int, default=1024)
+    args = parser.parse_args()
+
+    sock = socket.create_connection((args.host, args.port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    requests = [make_request(target, args.host) for target in TARGETS]
+    buffer = b""
+    step = max(1, (args.requests - args.warmup) // args.samples)
+    baseline = None
+    rss = 0
+    for i in range(args.requests):
+        sock.sendall(requests[i % len(requests)])
+        buffer, _ = read_responses(sock, 1, buffer)
+        if i + 1 >= args.warmup and (i + 1 - args.warmup) % step == 0:
+            rss = rss_kb(args.pid)
+            baseline = rss if baseline is None else baseline
+            print(f"{i + 1:>9} requests: VmRSS {rss} kB ({rss - baseline:+d} kB)")
+    # Замер до закрытия соединения: при закрытии сессия освобождает всё, что накопила
+    growth = rss - baseline
+    sock.close()
+    print(f"growth after warm-up: {growth} kB")
+    sys.exit(1 if growth > args.max_growth_kb else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Сравнение последовательных и конвейерных (pipelined) запросов на одном соединении.
+# Для каждого режима выводятся квантили времени пачки запросов и число recv, за которое пришли ответы:
+# при конвейере сервер отдаёт ответы на пачку одной записью, поэтому recv обычно один.
+import argparse
+import socket
+import statistics
+import time
+
+TARGETS = ["/api/v1/maps", "/api/v1/maps/map1", "/index.html"]
+
+
+def make_request(target, host):
+    return f"GET {target} HTTP/1.1\r\nHost: {host}\r\nConnection: keep-alive\r\n\r\n".encode()
+
+
+def read_responses(sock, count, buffer):
+    # Ответы сервера всегда содержат Content-Length
+    recvs = 0
+    done = 0
+    while done < count:
+        head_end = buffer.find(b"\r\n\r\n")
+        if head_end >= 0:
+            length = 0
+            for line in buffer[:head_end].split(b"\r\n")[1:]:
+                name, _, value = line.partition(b":")
+                if name.strip().lower() == b"content-length":
+                    length = int(value)
+            if len(buffer) >= head_end + 4 + length:
+                buffer = buffer[head_end + 4 + length:]
+                done += 1
+                continue
+        chunk = sock.recv(1 << 20)
+        if not chunk:
+            raise ConnectionError("connection closed by server")
+        recvs += 1
+        buffer += chunk
+    return buffer, recvs
+
+
+def run(host, port, depth, rounds, pipelined):
+    sock = socket.create_connection((host, port))
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    requests = [make_request(TARGETS[i % len(TARGETS)], host) for i in range(depth)]
+    times = []
+    total_recvs = 0
+    buffer = b""
+    for _ in range(rounds):
+        start = time.perf_counter()
+        if pipelined:
+            sock.sendall(b"".join(requests))
+            buffer, recvs = read_responses(sock, depth, buffer)
+            total_recvs += recvs
+        else:
+            for request in requests:
+                sock.sendall(request)
+                buffer, recvs = read_responses(sock, 1, buffer)
+                total_recvs += recvs
+        times.append((time.perf_counter() - start) * 1000)
+    sock.close()
+    times.sort()
+    return {
+        "p50": statistics.median(times),
+        "p99": times[min(len(times) - 1, int(len(times) * 0.99))],
+        "recv": total_recvs / rounds,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--depth", type=int, default=8, help="запросов в пачке")
+    parser.add_argument("--rounds", type=int, default=2000)
+    args = parser.parse_args()
+    for name, pipelined in (("sequential", False), ("pipelined", True)):
+        res = run(args.host, args.port, args.depth, args.rounds, pipelined)
+        print(f"{name:>10}: p50 {res['p50']:.3f} ms, p99 {res['p99']:.3f} ms, recv per batch {res['recv']:.2f}")
+
+
+if __name__ == "__main__":
+    main()
@@ -1,14 +1,17 @@
 #include "app.h"
+#include "json_writer.h"
 #include "log.h"
 #include <boost/format.hpp>
+#include <algorithm>
 
 std::atomic<uint64_t> app::Player::idn = 0;
 
 std::string app::JsonMessage(std::string_view code, std::string_view message) {
-    js::object msg;
-    msg["code"] = code.data();
-    msg["message"] = message.data();
-    return serialize(msg);
+    std::string msg;
+    msg.reserve(24 + code.size() + message.size());
+    util::JsonWriter writer{msg};
+    writer.BeginObject().Key("code"sv).String(code).Key("message"sv).String(message).EndObject();
+    return msg;
 }
 
 namespace app {
@@ -44,6 +47,28 @@ namespace app {
         return serialize(mapEl);
     }
 
+    MapBodies::MapBodies(const model::Game& game) {
+        ModelToJson jmodel(game);
+        maps_ = Prepare(jmodel.GetMaps());
+        for (const auto& map : game.GetMaps()) {
+            map_by_id_.emplace(*map.GetId(), Prepare(jmodel.GetMap(*map.GetId())));
+        }
+    }
+
+    const PreparedBody* MapBodies::FindMap(std::string_view id) const {
+        if (auto it = map_by_id_.find(std::string(id)); it != map_by_id_.end()) {
+            return &it->second;
+        }
+        return nullptr;
+    }
+
+    PreparedBody MapBodies::Prepare(std::string body) {
+        PreparedBody prepared;
+        prepared.etag = '"' + ToHex(std::hash<std::string>{}(body)) + ToHex(body.size()) + '"';
+        prepared.body = std::make_shared<const std::string>(std::move(body));
+        return prepared;
+    }
+
     js::array ModelToJson::GetRoads(const model::Map::Roads& roads) {
         js::array arr;
         for (auto& r : roads) {
@@ -88,70 +113,333 @@ namespace app {
         return arr;
     }
 
-    void Player::Move(std::string_view move_cmd) {
-        model::Move dog_move;
-        std::cout << "Move: " << move_cmd << std::endl;
-        if (move_cmd == "L"sv) {
-            dog_move = model::Move::LEFT;
+    SessionStrands::SessionStrands(net::io_context& ioc, model::Game& game)
+        : SessionStrands(std::vector<net::io_context*>{&ioc}, game) {
+    }
+
+    SessionStrands::SessionStrands(const std::vector<net::io_context*>& contexts, model::Game& game) {
+        size_t next_context = 0;
+        for (const auto& map : game.GetMaps()) {
+            auto session = game.FindGameSession(map.GetId());
+            if (session == nullptr) {
+                session = game.AddGameSession(map.GetId());
+            }
+            auto strand = net::make_strand(*contexts[next_context]);
+            next_context = (next_context + 1) % contexts.size();
+            sessions_.emplace(map.GetId(), SessionContext{ session, strand, nullptr, std::make_shared<StateFeed>(*session),
+                std::make_shared<TickStats>(), std::make_shared<SnapshotPublisher>(*session), std::make_shared<CommandQueue>() });
         }
-        else if (move_cmd == "R"sv) {
-            dog_move = model::Move::RIGHT;
+    }
+
+    const SessionStrands::Strand* SessionStrands::FindStrand(const model::Map::Id& id) const noexcept {
+        if (auto it = sessions_.find(id); it != sessions_.end()) {
+            return &it->second.strand;
         }
-        else if (move_cmd == "U"sv) {
-            dog_move = model::Move::UP;
+        return nullptr;
+    }
+
+    void SessionStrands::StartTickers(std::chrono::milliseconds period, size_t max_catch_up) {
+        if (period == std::chrono::milliseconds::zero()) {
+            return;
+        }
+        tickers_running_.store(true, std::memory_order_release);
+        // Набор сессий после конструктора не меняется, поэтому обработчики держат ссылки на элементы sessions_
+        for (auto& [id, context] : sessions_) {
+            context.ticker = std::make_shared<ticker::Ticker>(context.strand, period,
+                [&id, &context](std::chrono::milliseconds delta) {
+                    TickSession(id, context, delta);
+                },
+                max_catch_up
+            );
+            context.stats->cadence.store(&context.ticker->GetStats(), std::memory_order_release);
+            context.ticker->Start();
         }
-        else if (move_cmd == "D"sv) {
-            dog_move = model::Move::DOWN;
+    }
+
+    void SessionStrands::TickAll(std::chrono::milliseconds time_delta_ms) {
+        for (auto& [id, context] : sessions_) {
+            context.snapshots->BeginWrite();
+            net::post(context.strand, [&id, &context, time_delta_ms] {
+                TickSession(id, context, time_delta_ms);
+                context.snapshots->EndWrite();
+            });
         }
-        else if (move_cmd == ""sv) {
-            dog_move = model::Move::STAND;
+    }
+
+    void SessionStrands::EnqueueMove(const model::Map::Id& id, size_t dog_index, model::Move move) {
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) {
+            return;
+        }
+        auto& context = it->second;
+        // С тикером команды ждут начала следующего тика
+        if (tickers_running_.load(std::memory_order_acquire)) {
+            context.commands->Push({dog_index, move});
+            return;
+        }
+        // Без тикера (тики через /api/v1/game/tick) очередь разбирается отдельным проходом, чтобы игрок, как и раньше,
+        // видел результат своей команды. Каждая команда до своего применения делает снимок устаревшим
+        context.snapshots->BeginWrite();
+        context.commands->Push({dog_index, move});
+        if (context.commands->TryScheduleDrain()) {
+            net::post(context.strand, [&context] {
+                context.commands->DrainStarted();
+                DrainCommands(context);
+            });
         }
-        else {
-            throw std::invalid_argument("Invalid argument");
+    }
+
+    void SessionStrands::DrainCommands(SessionContext& context) {
+        const size_t taken = context.commands->Drain(*context.session);
+        if (taken != 0) {
+            context.snapshots->PublishAll();
+            context.snapshots->EndWrite(static_cast<uint32_t>(taken));
+        }
+    }
+
+    void SessionStrands::TickSession(const model::Map::Id& id, SessionContext& context, std::chrono::milliseconds delta) {
+        using namespace std::chrono;
+        auto& session = *context.session;
+        auto& stats = *context.stats;
+        const auto start = steady_clock::now();
+        const size_t commands = context.commands->Drain(session);
+        session.Tick(delta);
+        context.feed->Publish();
+        context.snapshots->PublishAll();
+        if (!context.ticker && commands != 0) {
+            // Команды, поставленные через EnqueueMove без тикера, отмечены BeginWrite
+            context.snapshots->EndWrite(static_cast<uint32_t>(commands));
+        }
+        const auto end = steady_clock::now();
+        const int64_t duration_us = duration_cast<microseconds>(end - start).count();
+        stats.ticks.fetch_add(1, std::memory_order_relaxed);
+        stats.total_us.fetch_add(duration_us, std::memory_order_relaxed);
+        stats.last_us.store(duration_us, std::memory_order_relaxed);
+        if (duration_us > stats.max_us.load(std::memory_order_relaxed)) {
+            stats.max_us.store(duration_us, std::memory_order_relaxed);
+        }
+        size_t bucket = 0;
+        for (int64_t bound = TICK_HISTOGRAM_BASE.count(); bucket + 1 < TICK_HISTOGRAM_BUCKETS && duration_us >= bound; bound *= 2) {
+            ++bucket;
+        }
+        stats.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+        if (end - stats.window_start >= TICK_STATS_PERIOD) {
+            const uint64_t ticks = stats.ticks.exchange(0, std::memory_order_relaxed);
+            const int64_t total_us = stats.total_us.exchange(0, std::memory_order_relaxed);
+            const int64_t max_us = stats.max_us.exchange(0, std::memory_order_relaxed);
+            std::array<uint64_t, TICK_HISTOGRAM_BUCKETS> histogram;
+            for (size_t i = 0; i < TICK_HISTOGRAM_BUCKETS; ++i) {
+                histogram[i] = stats.histogram[i].exchange(0, std::memory_order_relaxed);
+            }
+            server_logging::SessionTicksRecord record;
+            record.map_id = *id;
+            record.ticks = ticks;
+            record.avg_ms = static_cast<double>(total_us) / 1000.0 / static_cast<double>(ticks);
+            record.max_ms = static_cast<double>(max_us) / 1000.0;
+            record.histogram = histogram;
+            record.histogram_base_ms = static_cast<double>(TICK_HISTOGRAM_BASE.count()) / 1000.0;
+            if (auto* cadence = stats.cadence.load(std::memory_order_acquire)) {
+                const uint64_t total_overruns = cadence->overruns.load(std::memory_order_relaxed);
+                const uint64_t total_dropped = cadence->dropped_steps.load(std::memory_order_relaxed);
+                record.overruns = total_overruns - stats.window_overruns;
+                record.dropped_ticks = total_dropped - stats.window_dropped;
+                stats.window_overruns = total_overruns;
+                stats.window_dropped = total_dropped;
+                record.lag_ms = static_cast<double>(cadence->last_lag_us.load(std::memory_order_relaxed)) / 1000.0;
+                record.max_lag_ms = static_cast<double>(cadence->max_lag_us.exchange(0, std::memory_order_relaxed)) / 1000.0;
+            }
+            stats.window_start = end;
+            LOGSRV().SessionTicks(record);
         }
-        session_->MoveDog(dog_->GetId(), dog_move);    
     }
 
-    Player* PlayerTokens::FindPlayer(Token token) const {
-        if (token_to_player.contains(token)) {
-            return token_to_player.at(token);
+    std::vector<SessionTickReport> SessionStrands::GetTickStats() const {
+        std::vector<SessionTickReport> reports;
+        reports.reserve(sessions_.size());
+        for (const auto& [id, context] : sessions_) {
+            const auto& stats = *context.stats;
+            SessionTickReport report{
+                id,
+                stats.ticks.load(std::memory_order_relaxed),
+                std::chrono::microseconds{stats.total_us.load(std::memory_order_relaxed)},
+                std::chrono::microseconds{stats.max_us.load(std::memory_order_relaxed)},
+                std::chrono::microseconds{stats.last_us.load(std::memory_order_relaxed)}
+            };
+            for (size_t i = 0; i < TICK_HISTOGRAM_BUCKETS; ++i) {
+                report.histogram[i] = stats.histogram[i].load(std::memory_order_relaxed);
+            }
+            if (const auto* cadence = stats.cadence.load(std::memory_order_acquire)) {
+                report.overruns = cadence->overruns.load(std::memory_order_relaxed);
+                report.dropped_ticks = cadence->dropped_steps.load(std::memory_order_relaxed);
+                report.lag = std::chrono::microseconds{cadence->last_lag_us.load(std::memory_order_relaxed)};
+                report.max_lag = std::chrono::microseconds{cadence->max_lag_us.load(std::memory_order_relaxed)};
+            }
+            reports.push_back(std::move(report));
+        }
+        return reports;
+    }
+
+    std::string TickStatsToJson(std::vector<SessionTickReport> reports) {
+        std::sort(reports.begin(), reports.end(), [](const SessionTickReport& lhs, const SessionTickReport& rhs) {
+            return lhs.max > rhs.max;
+        });
+        const auto to_ms = [](std::chrono::microseconds us) {
+            return static_cast<double>(us.count()) / 1000.0;
+        };
+        std::string body;
+        body.reserve(64 + reports.size() * 320);
+        util::JsonWriter writer{body};
+        writer.BeginObject()
+            .Key("histogramBaseMs"sv).Number(to_ms(TICK_HISTOGRAM_BASE))
+            .Key("sessions"sv).BeginArray();
+        for (const auto& report : reports) {
+            const double avg_ms = report.ticks == 0 ? 0.0 : to_ms(report.total) / static_cast<double>(report.ticks);
+            writer.BeginObject()
+                .Key("mapId"sv).String(*report.map_id)
+                .Key("ticks"sv).Number(report.ticks)
+                .Key("avgMs"sv).Number(avg_ms)
+                .Key("maxMs"sv).Number(to_ms(report.max))
+                .Key("lastMs"sv).Number(to_ms(report.last))
+                .Key("histogram"sv).BeginArray();
+            for (const uint64_t count : report.histogram) {
+                writer.Number(count);
+            }
+            writer.EndArray()
+                .Key("overruns"sv).Number(report.overruns)
+                .Key("droppedTicks"sv).Number(report.dropped_ticks)
+                .Key("lagMs"sv).Number(to_ms(report.lag))
+                .Key("maxLagMs"sv).Number(to_ms(report.max_lag))
+                .EndObject();
+        }
+        writer.EndArray().EndObject();
+        return body;
+    }
+
+    bool SessionStrands::Subscribe(const model::Map::Id& id, std::shared_ptr<StateSubscriber> subscriber) {
+        auto it = sessions_.find(id);
+        if (it == sessions_.end()) {
+            return false;
+        }
+        net::dispatch(it->second.strand, [feed = it->second.feed, subscriber = std::move(subscriber)]() mutable {
+            feed->Subscribe(std::move(subscriber));
+        });
+        return true;
+    }
+
+    void SessionStrands::PublishDog(const model::Map::Id& id, size_t dog_index) {
+        if (auto it = sessions_.find(id); it != sessions_.end()) {
+            it->second.snapshots->PublishDog(dog_index);
+        }
+    }
+
+    std::shared_ptr<const SessionSnapshot> SessionStrands::LoadSnapshot(const model::Map::Id& id) const {
+        if (auto it = sessions_.find(id); it != sessions_.end()) {
+            return it->second.snapshots->Load();
         }
         return nullptr;
     }
 
+    std::optional<model::Move> ParseMove(std::string_view move_cmd) noexcept {
+        if (move_cmd == "L"sv) {
+            return model::Move::LEFT;
+        }
+        if (move_cmd == "R"sv) {
+            return model::Move::RIGHT;
+        }
+        if (move_cmd == "U"sv) {
+            return model::Move::UP;
+        }
+        if (move_cmd == "D"sv) {
+            return model::Move::DOWN;
+        }
+        if (move_cmd.empty()) {
+            return model::Move::STAND;
+        }
+        return std::nullopt;
+    }
+
+    size_t PlayerTokens::Hash(const Token& token) noexcept {
+        // Токены случайные, перемешивание нужно только чтобы шард и слот зависели от обеих половин
+        uint64_t h = (*token).hi ^ ((*token).lo * 0x9e3779b97f4a7c15ULL);
+        h ^= h >> 29;
+        return static_cast<size_t>(h);
+    }
+
+    Player* PlayerTokens::FindPlayer(const Token& token) const noexcept {
+        const size_t hash = Hash(token);
+        const Table* table = shards_[hash % SHARD_COUNT].table.load(std::memory_order_acquire);
+        if (table == nullptr) {
+            return nullptr;
+        }
+        const size_t mask = table->slots.size() - 1;
+        for (size_t i = (hash / SHARD_COUNT) & mask;; i = (i + 1) & mask) {
+            const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+            if (entry == nullptr) {
+                return nullptr;
+            }
+            if (entry->token == token) {
+                return entry->player;
+            }
+        }
+    }
+
+    void PlayerTokens::Place(Table& table, const Entry* entry, size_t hash) noexcept {
+        const size_t mask = table.slots.size() - 1;
+        size_t i = (hash / SHARD_COUNT) & mask;
+        while (table.slots[i].load(std::memory_order_relaxed) != nullptr) {
+            i = (i + 1) & mask;
+        }
+        table.slots[i].store(entry, std::memory_order_release);
+    }
+
+    bool PlayerTokens::TryInsert(const Token& token, Player* player) {
+        const size_t hash = Hash(token);
+        Shard& shard = shards_[hash % SHARD_COUNT];
+        std::lock_guard lock{shard.mutex};
+        if (FindPlayer(token) != nullptr) {
+            return false;
+        }
+        const Table* current = shard.table.load(std::memory_order_relaxed);
+        // Заполнение держится не выше половины, чтобы цепочки проб оставались короткими
+        if (current == nullptr || (shard.size + 1) * 2 > current->slots.size()) {
+            auto grown = std::make_unique<Table>(current ? current->slots.size() * 2 : INITIAL_CAPACITY);
+            for (const auto& entry : shard.entries) {
+                Place(*grown, &entry, Hash(entry.token));
+            }
+            shard.tables.reserve(shard.tables.size() + 1);
+            shard.table.store(grown.get(), std::memory_order_release);
+            shard.tables.push_back(std::move(grown));
+        }
+        const Entry& entry = shard.entries.emplace_back(Entry{token, player});
+        Place(*shard.tables.back(), &entry, hash);
+        ++shard.size;
+        return true;
+    }
+
     Token PlayerTokens::AddPlayer(Player* player) {
-        Token token{GetToken()};
-        token_to_player[token] = player;
+        Token token = GetToken();
+        // Совпадение 128-битных случайных токенов практически невозможно, но занятый токен выдавать нельзя
+        while (!TryInsert(token, player)) {
+            token = GetToken();
+        }
         return token;
     }
 
     std::string ToHex(uint64_t n) {
-        std::string hex;
-        while (n > 0) {
-            int r = n % 16;
-            char c = (r < 10) ? ('0' + r) : ('a' + r - 10);
-            hex = c + hex;
-            n /= 16;
-        }
-        while (hex.size() < 16) {
-            hex = '0' + hex;
-        }
+        std::string hex(util::HEX64_SIZE, '0');
+        util::WriteHex64(n, hex.data());
         return hex;
     }
 
     std::pair<std::string, bool> App::GetMapBodyJson(std::string_view mapName) const {
-        ModelToJson jmodel(game_);
-        std::string body;
         if (mapName.empty()) {
-            body = jmodel.GetMaps();
+            return std::make_pair(*map_bodies_.GetMaps().body, true);
         }
-        else {
-            body = jmodel.GetMap(mapName);
-            if (!body.size()) {
-                return std::make_pair(JsonMessage("mapNotFound"sv, "Map not found"sv), false);
-            }
+        auto prepared = map_bodies_.FindMap(mapName);
+        if (prepared == nullptr) {
+            return std::make_pair(JsonMessage("mapNotFound"sv, "Map not found"sv), false);
         }
-        return std::make_pair(std::move(body), true);
+        return std::make_pair(*prepared->body, true);
     }
     //
     std::pair<std::string, JoinError> App::ResponseJoin(std::string_view jsonBody) {
@@ -182,31 +470,31 @@ namespace app {
         if (map == nullptr) {
             return std::make_pair(JsonMessage("mapNotFound"sv, "Map not found"sv), JoinError::MapNotFound);
         }
-        js::object msg;
-        std::string token;
-        uint64_t id;
+        std::unique_lock lock{players_mutex_};
         auto player = GetPlayer(userName, mapId);
-        token = *player_tokens_.AddPlayer(player);
-        id = *player->GetId();
-        msg["authToken"] = token;
-        msg["playerId"]  = id;
-        return std::make_pair(std::move(serialize(msg)), JoinError::None);
+        session_strands_.PublishDog(player->MapId(), player->DogIndex());
+        const std::string token = security::TokenToString(player_tokens_.AddPlayer(player));
+        std::string msg;
+        msg.reserve(80);
+        util::JsonWriter writer{msg};
+        writer.BeginObject().Key("authToken"sv).String(token).Key("playerId"sv).Number(*player->GetId()).EndObject();
+        return std::make_pair(std::move(msg), JoinError::None);
     }
 
     std::pair<std::string, error_code> App::ActionMove(const Token& token, std::string_view jsonBody) {
-        std::string move;
+        std::optional<model::Move> move;
         try {
             js::value const jv = js::parse(to_booststr(jsonBody));
-            move = jv.at("move").as_string();
-            Player* player = player_tokens_.FindPlayer(token);
-            player->Move(move);
+            move = ParseMove(jv.at("move").as_string());
         }
         catch (const std::exception&) {
+        }
+        Player* player = GetPlayer(token);
+        if (!move || player == nullptr) {
             return std::make_pair(JsonMessage("invalidArgument"sv, "Failed to parse action"sv), error_code::InvalidArgument);
         }
-        
-        js::object msg;
-        return std::make_pair(std::move(serialize(msg)), error_code::None);
+        session_strands_.EnqueueMove(player->MapId(), player->DogIndex(), *move);
+        return std::make_pair("{}"s, error_code::None);
     }
 
     std::pair<std::string, error_code> App::Tick(std::string_view jsonBody) {
@@ -232,58 +520,112 @@ namespace app {
         catch (const std::exception&) {
             return std::make_pair(JsonMessage("invalidArgument"sv, "Failed to parse tick request JSON"sv), error_code::InvalidArgument);
         }
-        game_.Tick(time_delta_mc);
-        js::object msg;
-        return std::make_pair(std::move(serialize(msg)), error_code::None);
+        session_strands_.TickAll(time_delta_mc);
+        return std::make_pair("{}"s, error_code::None);
+    }
+
+    std::string App::GetTickStats() const {
+        return TickStatsToJson(session_strands_.GetTickStats());
     }
 
     std::pair<std::string, error_code> App::GetPlayers(const Token& token) const {
-        js::object msg;
-        Player* player = player_tokens_.FindPlayer(token);
+        Player* player = GetPlayer(token);
         auto session = player->GetSession();
         const auto &dogs = session->GetDogs();
+        std::string msg;
+        msg.reserve(2 + dogs.size() * 48);
+        util::JsonWriter writer{msg};
+        writer.BeginObject();
         for (const auto& dog : dogs) {
-            js::object jname;
-            jname["name"] = to_booststr(dog.GetName());
-            msg[std::to_string(*dog.GetId())] = jname;
+            writer.Key(*dog.GetId()).BeginObject().Key("name"sv).String(dog.GetName()).EndObject();
         }
-        return std::make_pair(std::move(serialize(msg)),error_code::None);
+        writer.EndObject();
+        return std::make_pair(std::move(msg), error_code::None);
     }
 
     std::pair<std::string, error_code> App::GetState(const Token& token) const {
-        auto put_array = [](const auto &x, const auto &y) {
-            js::array jarr;
-            jarr.emplace_back(x);
-            jarr.emplace_back(y);
-            return jarr;
-        };
-        Player* player = player_tokens_.FindPlayer(token);
-        js::object state;
+        Player* player = GetPlayer(token);
         auto session = player->GetSession();
         const auto &dogs = session->GetDogs();
+        std::string msg;
+        msg.reserve(32 + dogs.size() * DOG_STATE_SIZE_HINT);
+        util::JsonWriter writer{msg};
+        writer.BeginObject().Key("players"sv).BeginObject();
         for (const auto &dog : dogs) {
-            js::object dog_param;
-            dog_param["pos"] = put_array(dog.GetPoint().x, dog.GetPoint().y);
-            dog_param["speed"] = put_array(dog.GetSpeed().x, dog.GetSpeed().y);
-            dog_param["dir"] = dog.GetDirection();
-            state[std::to_string(*dog.GetId())] = dog_param;
+            writer.Key(*dog.GetId());
+            WriteDogState(writer, dog.GetPoint(), dog.GetSpeed(), dog.GetDir());
+        }
+        writer.EndObject().EndObject();
+        return std::make_pair(std::move(msg), error_code::None);
+    }
+
+    std::optional<PreparedBody> App::GetPlayersFromSnapshot(const Token& token) const {
+        Player* player = GetPlayer(token);
+        if (player == nullptr) {
+            return std::nullopt;
+        }
+        auto snapshot = session_strands_.LoadSnapshot(player->MapId());
+        if (!snapshot) {
+            return std::nullopt;
         }
-        js::object players;
-        players["players"] = state;
-        return std::make_pair(std::move(serialize(players)), error_code::None);
+        return snapshot->PlayersBody();
+    }
+
+    std::optional<PreparedBody> App::GetStateFromSnapshot(const Token& token) const {
+        Player* player = GetPlayer(token);
+        if (player == nullptr) {
+            return std::nullopt;
+        }
+        auto snapshot = session_strands_.LoadSnapshot(player->MapId());
+        if (!snapshot) {
+            return std::nullopt;
+        }
+        return snapshot->StateBody();
     }
 
     std::pair<std::string, error_code> App::CheckToken(const Token& token) const {
-        Player* player = player_tokens_.FindPlayer(token);
+        Player* player = GetPlayer(token);
         if (player == nullptr) {
             return std::make_pair(std::move(app::JsonMessage("unknownToken"sv, "Player token has not been found"sv)), error_code::UnknownToken);
         }
         return std::make_pair("", error_code::None);
     }
 
+    const SessionStrands::Strand* App::FindSessionStrand(const Token& token) const {
+        Player* player = GetPlayer(token);
+        if (player == nullptr) {
+            return nullptr;
+        }
+        return session_strands_.FindStrand(player->MapId());
+    }
+
+    const SessionStrands::Strand* App::FindJoinStrand(std::string_view jsonBody) const {
+        js::error_code ec;
+        js::value const jv = js::parse(to_booststr(jsonBody), ec);
+        if (ec) {
+            return nullptr;
+        }
+        const auto* obj = jv.if_object();
+        if (obj == nullptr || !obj->contains("mapId")) {
+            return nullptr;
+        }
+        const auto* map_id = obj->at("mapId").if_string();
+        if (map_id == nullptr) {
+            return nullptr;
+        }
+        return session_strands_.FindStrand(model::Map::Id{std::string(map_id->data(), map_id->size())});
+    }
+
+    bool App::SubscribeState(const Token& token, std::shared_ptr<StateSubscriber> subscriber) const {
+        Player* player = GetPlayer(token);
+        if (player == nullptr) {
+            return false;
+        }
+        return session_strands_.Subscribe(player->MapId(), std::move(subscriber));
+    }
+
     Player* App::GetPlayer(const Token& token) const {
-        Player* player = player_tokens_.FindPlayer(token);
-        return player;
+        return player_tokens_.FindPlayer(token);
     }
 
     Player* App::GetPlayer(std::string_view nickName, std::string_view mapId) {
@@ -326,17 +668,6 @@ namespace app {
         return nullptr;
     }
 
-    const Player::Id* Players::FindPlayerId(std::string_view player_name) const noexcept {
-        auto it = std::find_if(players_.begin(), players_.end(), [&](const auto& player) {
-                return player->GetName() == player_name;
-            }
-        );
-        if (it != players_.end()) {
-            return &(*it)->GetId();
-        }
-        return nullptr;
-    }
-
     Player* Players::FindPlayer(Player::Id player_id) const noexcept {
         if (auto it = player_id_to_index_.find(player_id); it != player_id_to_index_.end()) {
             auto pl = players_.at(it->second).get();
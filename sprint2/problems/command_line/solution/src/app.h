@@ -2,9 +2,20 @@
 #include "sdk.h"
 #include <boost/json.hpp>
 #include <boost/asio/strand.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <shared_mutex>
 #include "model.h"
+#include "command_queue.h"
+#include "session_snapshot.h"
+#include "state_feed.h"
 #include "token.h"
 #include "ticker.h"
 
@@ -30,12 +41,12 @@ namespace app {
 
     class ModelToJson {
     public:
-        explicit ModelToJson(model::Game& game) : game_{ game } {}
+        explicit ModelToJson(const model::Game& game) : game_{ game } {}
 
         std::string GetMaps() const;
         std::string GetMap(std::string_view nameMap) const;
     private:
-        model::Game& game_;
+        const model::Game& game_;
         static js::array GetRoads(const model::Map::Roads& roads);
         static js::array GetBuildings(const model::Map::Buildings& buildings);
         static js::array GetOffice(const model::Map::Offices& offices);
@@ -44,6 +55,23 @@ namespace app {
     std::string JsonMessage(std::string_view code, std::string_view message);
     std::string ToHex(uint64_t n);
 
+    // Карты не меняются после json_loader::LoadGame, поэтому ответы /api/v1/maps и /api/v1/maps/{id}
+    // сериализуются один раз при старте и дальше отдаются как общие неизменяемые буферы
+    class MapBodies {
+    public:
+        explicit MapBodies(const model::Game& game);
+
+        const PreparedBody& GetMaps() const noexcept {
+            return maps_;
+        }
+        const PreparedBody* FindMap(std::string_view id) const;
+
+    private:
+        static PreparedBody Prepare(std::string body);
+        PreparedBody maps_;
+        std::unordered_map<std::string, PreparedBody> map_by_id_;
+    };
+
     class Player {
     public:
         using Id = util::Tagged<uint64_t, Player>;
@@ -61,7 +89,9 @@ namespace app {
         const model::GameSession* GetSession() {
             return session_;
         }
-        void Move(std::string_view move_cmd);
+        size_t DogIndex() const noexcept {
+            return dog_->GetIndex();
+        }
 
     private:
         static std::atomic<uint64_t> idn;
@@ -70,13 +100,144 @@ namespace app {
         model::Dog* dog_;
     };
 
+    // Гистограмма длительности тиков: корзина 0 - короче TICK_HISTOGRAM_BASE, корзина i - короче
+    // TICK_HISTOGRAM_BASE * 2^i, последняя корзина - всё остальное
+    inline constexpr size_t TICK_HISTOGRAM_BUCKETS = 12;
+    inline constexpr std::chrono::microseconds TICK_HISTOGRAM_BASE{100};
+
+    // Длительность тиков одной сессии за текущее окно наблюдения и ритм её тикера
+    struct SessionTickReport {
+        model::Map::Id map_id;
+        uint64_t ticks = 0;
+        std::chrono::microseconds total{0};
+        std::chrono::microseconds max{0};
+        std::chrono::microseconds last{0};
+        std::array<uint64_t, TICK_HISTOGRAM_BUCKETS> histogram{};
+        // Поля тикера, нули при тиках через /api/v1/game/tick. Счётчики - с момента старта, max_lag - за окно
+        uint64_t overruns = 0;
+        uint64_t dropped_ticks = 0;
+        std::chrono::microseconds lag{0};
+        std::chrono::microseconds max_lag{0};
+    };
+
+    // Тело ответа /api/v1/game/tick/stats: по объекту на сессию, сессии с самым долгим тиком окна идут первыми
+    std::string TickStatsToJson(std::vector<SessionTickReport> reports);
+
+    // Каждой игровой сессии (по id карты) сопоставлены свой strand, свой тикер и рассылка состояния.
+    // Сессии изолированы друг от друга, поэтому их тики идут параллельно: strand-ы сессий распределяются
+    // по переданным io_context по кругу. С одним io_context на пул потоков сессии делят его потоки,
+    // в режиме sharded каждая сессия живёт в одном из шардов, и тики выполняются на всех ядрах.
+    // Всё, что читает или меняет состояние сессии, должно выполняться в её strand.
+    // Сессии создаются для всех карт сразу, поэтому после конструктора набор сессий не меняется
+    class SessionStrands {
+    public:
+        using Strand = net::strand<net::io_context::executor_type>;
+
+        SessionStrands(net::io_context& ioc, model::Game& game);
+        // contexts не пуст; сессия i-й карты получает strand в contexts[i % contexts.size()]
+        SessionStrands(const std::vector<net::io_context*>& contexts, model::Game& game);
+        SessionStrands(const SessionStrands&) = delete;
+        SessionStrands& operator=(const SessionStrands&) = delete;
+
+        const Strand* FindStrand(const model::Map::Id& id) const noexcept;
+        // max_catch_up - сколько пропущенных тиков тикер выполняет подряд после задержки, см. ticker::Ticker
+        void StartTickers(std::chrono::milliseconds period, size_t max_catch_up = ticker::Ticker::DEFAULT_MAX_CATCH_UP);
+        void TickAll(std::chrono::milliseconds time_delta_ms);
+        // Может вызываться из любого потока: подписка выполняется в strand сессии
+        bool Subscribe(const model::Map::Id& id, std::shared_ptr<StateSubscriber> subscriber);
+        // Может вызываться из любого потока
+        std::vector<SessionTickReport> GetTickStats() const;
+        // Может вызываться из любого потока. Команда попадает в очередь сессии и применяется в начале следующего тика;
+        // если тикеры не запущены - отдельным проходом в strand, до которого снимок считается устаревшим
+        void EnqueueMove(const model::Map::Id& id, size_t dog_index, model::Move move);
+        // Публикует снимок после изменения одной собаки (вход игрока, команда движения). Вызывается в strand сессии
+        void PublishDog(const model::Map::Id& id, size_t dog_index);
+        // Может вызываться из любого потока. nullptr, если сессии нет или снимок отстаёт от поставленного тика
+        std::shared_ptr<const SessionSnapshot> LoadSnapshot(const model::Map::Id& id) const;
+
+        // Раз в это время сводка по тикам каждой сессии (длительности, гистограмма, ритм тикера) пишется в лог,
+        // и окно наблюдения начинается заново
+        static constexpr std::chrono::seconds TICK_STATS_PERIOD{10};
+
+    private:
+        // Пишется в strand сессии, читается из любого потока
+        struct TickStats {
+            std::atomic<uint64_t> ticks = 0;
+            std::atomic<int64_t> total_us = 0;
+            std::atomic<int64_t> max_us = 0;
+            std::atomic<int64_t> last_us = 0;
+            std::array<std::atomic<uint64_t>, TICK_HISTOGRAM_BUCKETS> histogram{};
+            // Показатели тикера сессии; nullptr, пока тикеры не запущены
+            std::atomic<ticker::Ticker::Stats*> cadence = nullptr;
+            // Только в strand сессии
+            std::chrono::steady_clock::time_point window_start = std::chrono::steady_clock::now();
+            uint64_t window_overruns = 0;
+            uint64_t window_dropped = 0;
+        };
+
+        struct SessionContext {
+            model::GameSession* session;
+            Strand strand;
+            std::shared_ptr<ticker::Ticker> ticker;
+            std::shared_ptr<StateFeed> feed;
+            std::shared_ptr<TickStats> stats;
+            std::shared_ptr<SnapshotPublisher> snapshots;
+            std::shared_ptr<CommandQueue> commands;
+        };
+
+        // Выполняет тик в strand сессии: применяет накопленные команды, двигает собак, рассылает и публикует
+        // состояние и учитывает длительность
+        static void TickSession(const model::Map::Id& id, SessionContext& context, std::chrono::milliseconds delta);
+        // Проход по очереди команд без тикера: применяет команды, публикует снимок и снимает отметки BeginWrite
+        static void DrainCommands(SessionContext& context);
+        using MapIdHasher = util::TaggedHasher<model::Map::Id>;
+        std::unordered_map<model::Map::Id, SessionContext, MapIdHasher> sessions_;
+        std::atomic<bool> tickers_running_ = false;
+    };
+
+    // Команда движения из запроса /api/v1/game/player/action; std::nullopt для неизвестной команды
+    std::optional<model::Move> ParseMove(std::string_view move_cmd) noexcept;
+
+    // Токены игроков. Таблица разбита на SHARD_COUNT шардов, в каждом открытая адресация по массиву атомарных
+    // указателей на неизменяемые записи. Записи только добавляются, поэтому FindPlayer не берёт блокировок
+    // и может вызываться из любого потока, в том числе из потоков ввода-вывода до передачи запроса в strand.
+    // AddPlayer блокирует только свой шард
     class PlayerTokens {
     public:
-        Player* FindPlayer(Token token) const;
+        PlayerTokens() = default;
+        PlayerTokens(const PlayerTokens&) = delete;
+        PlayerTokens& operator=(const PlayerTokens&) = delete;
+
+        Player* FindPlayer(const Token& token) const noexcept;
         Token AddPlayer(Player* player);
 
     private:
-        std::unordered_map<Token, Player*, util::TaggedHasher<Token>> token_to_player;
+        struct Entry {
+            Token token;
+            Player* player;
+        };
+        // Ёмкость таблицы - степень двойки. Пустой слот - nullptr, заполненный слот больше не меняется
+        struct Table {
+            explicit Table(size_t capacity) : slots(capacity) {}
+            std::vector<std::atomic<const Entry*>> slots;
+        };
+        struct Shard {
+            std::atomic<const Table*> table = nullptr;
+            std::mutex mutex;
+            size_t size = 0;
+            std::deque<Entry> entries;
+            // Таблицы, из которых вырос шард, не освобождаются: их ещё может читать FindPlayer
+            std::vector<std::unique_ptr<Table>> tables;
+        };
+        static constexpr size_t SHARD_COUNT = 16;
+        static constexpr size_t INITIAL_CAPACITY = 64;
+
+        static size_t Hash(const Token& token) noexcept;
+        static void Place(Table& table, const Entry* entry, size_t hash) noexcept;
+        bool TryInsert(const Token& token, Player* player);
+
+        std::array<Shard, SHARD_COUNT> shards_;
+        std::mutex generator_mutex_;
         std::random_device random_device_;
         std::mt19937_64 generator1_{[this] {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
@@ -86,10 +247,9 @@ namespace app {
             std::uniform_int_distribution<std::mt19937_64::result_type> dist;
             return dist(random_device_);
         }()};
-        std::string GetToken() {
-            std::string r1 = ToHex(generator1_());
-            std::string r2 = ToHex(generator2_());
-            return r1 + r2;
+        Token GetToken() {
+            std::lock_guard lock{generator_mutex_};
+            return Token{detail::TokenBits{generator1_(), generator2_()}};
         }
     };
 
@@ -97,7 +257,6 @@ namespace app {
     public:
         Player* Add(model::Dog *dog, model::GameSession *session);
         Player* FindPlayer(Player::Id player_id, model::Map::Id map_id) noexcept;
-        const Player::Id* FindPlayerId(std::string_view player_name) const noexcept;
         Player* FindPlayer(Player::Id player_id) const noexcept;
     
     private:
@@ -109,18 +268,37 @@ namespace app {
 
     class App {
     public:
-        explicit App(model::Game& game) : game_{ game } {}
+        App(model::Game& game, SessionStrands& session_strands)
+            : game_{ game }, session_strands_{ session_strands }, map_bodies_{ game } {}
 
+        const MapBodies& GetMapBodies() const noexcept {
+            return map_bodies_;
+        }
         std::pair<std::string, bool> GetMapBodyJson(std::string_view requestTarget) const;
         std::pair<std::string, JoinError> ResponseJoin(std::string_view jsonBody);
         std::pair<std::string, error_code> ActionMove(const Token& token, std::string_view jsonBody);
         std::pair<std::string, error_code> Tick(std::string_view jsonBody);
         std::pair<std::string, error_code> GetPlayers(const Token& token) const;
         std::pair<std::string, error_code> GetState(const Token& token) const;
+        // Те же ответы из опубликованного снимка сессии, без захода в strand. std::nullopt, если токен
+        // неизвестен или снимка нет: тогда запрос обрабатывается в strand через GetPlayers/GetState
+        std::optional<PreparedBody> GetPlayersFromSnapshot(const Token& token) const;
+        std::optional<PreparedBody> GetStateFromSnapshot(const Token& token) const;
         std::pair<std::string, error_code> CheckToken(const Token& token) const;
+        // Сводка по тикам всех сессий, см. TickStatsToJson. Может вызываться из любого потока
+        std::string GetTickStats() const;
+        const SessionStrands::Strand* FindSessionStrand(const Token& token) const;
+        const SessionStrands::Strand* FindJoinStrand(std::string_view jsonBody) const;
+        // Подписывает игрока на рассылку состояния его сессии; false, если токен неизвестен
+        bool SubscribeState(const Token& token, std::shared_ptr<StateSubscriber> subscriber) const;
     
     private:
         model::Game& game_;
+        SessionStrands& session_strands_;
+        const MapBodies map_bodies_;
+        // players_ общий для всех сессий, которые работают в разных strand.
+        // player_tokens_ потокобезопасен сам по себе
+        mutable std::shared_mutex players_mutex_;
         Players players_;
         PlayerTokens player_tokens_;
         Player* GetPlayer(const Token& token) const;
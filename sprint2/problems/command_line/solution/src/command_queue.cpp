@@ -0,0 +1,38 @@
+#include "command_queue.h"
+
+namespace app {
+
+    CommandQueue::~CommandQueue() {
+        for (Node* node = head_.load(std::memory_order_acquire); node != nullptr;) {
+            delete std::exchange(node, node->next);
+        }
+    }
+
+    void CommandQueue::Push(MoveCommand command) {
+        auto* node = new Node{command, head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    size_t CommandQueue::Drain(model::GameSession& session) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        if (node == nullptr) {
+            return 0;
+        }
+        const auto& dogs = session.GetDogs();
+        applied_in_.resize(dogs.size(), 0);
+        ++pass_;
+        size_t taken = 0;
+        while (node != nullptr) {
+            const MoveCommand& command = node->command;
+            if (command.dog_index < dogs.size() && applied_in_[command.dog_index] != pass_) {
+                applied_in_[command.dog_index] = pass_;
+                session.MoveDog(dogs[command.dog_index].GetId(), command.move);
+            }
+            delete std::exchange(node, node->next);
+            ++taken;
+        }
+        return taken;
+    }
+
+} //namespace app
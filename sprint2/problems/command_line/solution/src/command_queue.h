@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include "model.h"
+
+namespace app {
+
+    // Команды движения игроков одной сессии. Обработчики запросов добавляют команды из любых потоков без блокировок
+    // (стек Трайбера), strand сессии забирает весь стек одной атомарной операцией - в начале тика или отдельным
+    // проходом, см. SessionStrands::EnqueueMove. Стек отдаёт команды от новых к старым, поэтому из нескольких
+    // команд одной собаки применяется последняя, а остальные просто пропускаются
+    class CommandQueue {
+    public:
+        struct MoveCommand {
+            size_t dog_index = 0;
+            model::Move move = model::Move::STAND;
+        };
+
+        CommandQueue() = default;
+        CommandQueue(const CommandQueue&) = delete;
+        CommandQueue& operator=(const CommandQueue&) = delete;
+        ~CommandQueue();
+
+        // Может вызываться из любого потока
+        void Push(MoveCommand command);
+
+        // Отдельный проход по очереди вне тика. TryScheduleDrain возвращает true только одному вызывающему,
+        // пока проход не начался: он и ставит Drain в strand. Проход начинается с DrainStarted
+        bool TryScheduleDrain() noexcept {
+            return !drain_scheduled_.exchange(true, std::memory_order_acq_rel);
+        }
+        void DrainStarted() noexcept {
+            // Обмен, а не запись: так проход видит все команды, добавленные теми, кто застал флаг поднятым
+            drain_scheduled_.exchange(false, std::memory_order_acq_rel);
+        }
+
+        // Только в strand сессии. Применяет накопленные команды и возвращает, сколько команд забрано из очереди
+        size_t Drain(model::GameSession& session);
+
+    private:
+        struct Node {
+            MoveCommand command;
+            Node* next = nullptr;
+        };
+
+        std::atomic<Node*> head_ = nullptr;
+        std::atomic<bool> drain_scheduled_ = false;
+        // Только в strand сессии: номер прохода, в котором собака уже получила команду
+        std::vector<uint64_t> applied_in_;
+        uint64_t pass_ = 0;
+    };
+
+} //namespace app
@@ -1,4 +1,8 @@
 #include "dog.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DOG_X86_KERNELS
+#include <immintrin.h>
+#endif
 
 std::atomic<uint64_t> model::Dog::idn = 0;
 model::DSpeed model::Dog::zero_speed_ = DSpeed{0.0, 0.0};  
@@ -7,58 +11,141 @@ namespace model {
 
     using namespace std::literals;
 
-    std::string Dog::GetDirection() const {
-        switch (dir_) {
+    namespace {
+
+        double MsChronoToDoubleSec(std::chrono::milliseconds ms) {
+            static constexpr double to_sec = 1000.0;
+            return static_cast<double>(ms.count()) / to_sec;
+        }
+
+#ifdef DOG_X86_KERNELS
+        // Векторные ядра обрабатывают кратную ширине регистра часть массива и возвращают число обработанных элементов.
+        // Умножение и сложение выполняются отдельно (без FMA), чтобы результат не отличался от скалярного
+        __attribute__((target("avx2")))
+        size_t IntegrateAvx2(const double* pos, const double* speed, double dt, double* out, size_t n) {
+            const __m256d vdt = _mm256_set1_pd(dt);
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m256d p = _mm256_loadu_pd(pos + i);
+                const __m256d v = _mm256_loadu_pd(speed + i);
+                _mm256_storeu_pd(out + i, _mm256_add_pd(p, _mm256_mul_pd(v, vdt)));
+            }
+            return i;
+        }
+
+        __attribute__((target("sse2")))
+        size_t IntegrateSse2(const double* pos, const double* speed, double dt, double* out, size_t n) {
+            const __m128d vdt = _mm_set1_pd(dt);
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                const __m128d p = _mm_loadu_pd(pos + i);
+                const __m128d v = _mm_loadu_pd(speed + i);
+                _mm_storeu_pd(out + i, _mm_add_pd(p, _mm_mul_pd(v, vdt)));
+            }
+            return i;
+        }
+#endif
+
+        void Integrate(const double* pos, const double* speed, double dt, double* out, size_t n) {
+            size_t i = 0;
+#ifdef DOG_X86_KERNELS
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            i = has_avx2 ? IntegrateAvx2(pos, speed, dt, out, n) : IntegrateSse2(pos, speed, dt, out, n);
+#endif
+            for (; i < n; ++i) {
+                out[i] = pos[i] + speed[i] * dt;
+            }
+        }
+
+    } //namespace
+
+    size_t DogStates::Add(DPoint coord) {
+        const size_t index = Size();
+        x.push_back(coord.x);
+        y.push_back(coord.y);
+        speed_x.push_back(0.0);
+        speed_y.push_back(0.0);
+        dir.push_back(Direction::NORTH);
+        moving.push_back(0);
+        return index;
+    }
+
+    void DogStates::PopBack() {
+        x.pop_back();
+        y.pop_back();
+        speed_x.pop_back();
+        speed_y.pop_back();
+        dir.pop_back();
+        moving.pop_back();
+    }
+
+    void DogStates::SetSpeed(size_t index, DSpeed speed) {
+        speed_x[index] = speed.x;
+        speed_y[index] = speed.y;
+        moving[index] = !(speed == DSpeed{0.0, 0.0});
+    }
+
+    void IntegrateMovement(const DogStates& states, std::chrono::milliseconds move_time_ms, DCoord* end_x, DCoord* end_y) {
+        const double dt_second = MsChronoToDoubleSec(move_time_ms);
+        Integrate(states.x.data(), states.speed_x.data(), dt_second, end_x, states.Size());
+        Integrate(states.y.data(), states.speed_y.data(), dt_second, end_y, states.Size());
+    }
+
+    std::string_view DirectionName(Direction dir) noexcept {
+        switch (dir) {
         case Direction::NORTH:
-            return "U";
+            return "U"sv;
         case Direction::EAST:
-            return "R";
+            return "R"sv;
         case Direction::SOUTH:
-            return "D";
+            return "D"sv;
         case Direction::WEST:
-            return "L";
+            return "L"sv;
         }
-        return "U";
+        return "U"sv;
+    }
+
+    std::string Dog::GetDirection() const {
+        return std::string(DirectionName(states_->dir[index_]));
     }
 
     void Dog::Diraction(Move move, DDimension speed) {
         static constexpr double dzero = 0.0; 
         static constexpr double invert = -1.0; 
+        auto& dir = states_->dir[index_];
         switch (move) {
         case Move::LEFT:
-            speed_ = { invert*speed, dzero };
-            dir_ = Direction::WEST;
+            states_->SetSpeed(index_, { invert*speed, dzero });
+            dir = Direction::WEST;
             break;
         case Move::RIGHT:
-            speed_ = { speed, dzero };
-            dir_ = Direction::EAST;
+            states_->SetSpeed(index_, { speed, dzero });
+            dir = Direction::EAST;
             break;
         case Move::UP:
-            speed_ = { dzero, invert*speed };
-            dir_ = Direction::NORTH;
+            states_->SetSpeed(index_, { dzero, invert*speed });
+            dir = Direction::NORTH;
             break;
         case Move::DOWN:
-            speed_ = { dzero, speed };
-            dir_ = Direction::SOUTH;
+            states_->SetSpeed(index_, { dzero, speed });
+            dir = Direction::SOUTH;
             break;
         case Move::STAND:
-            speed_ = zero_speed_;
+            states_->SetSpeed(index_, zero_speed_);
             break;
         }
     }
 
-    DPoint Dog::GetEndPoint(std::chrono::milliseconds move_time_ms) {
-        auto msChronoToDoubleSec = [] (auto ms) {
-            static constexpr double to_sec = 1000.0;
-            return static_cast<double>(ms.count()) / to_sec;
-        };
+    DPoint Dog::GetEndPoint(std::chrono::milliseconds move_time_ms) const {
+        const DPoint coord = GetPoint();
         if (IsStanding()) {
-            return coord_;
+            return coord;
         }
-        double dt_second = msChronoToDoubleSec(move_time_ms);
+        double dt_second = MsChronoToDoubleSec(move_time_ms);
+        const DSpeed speed = GetSpeed();
         DPoint end_point;
-        end_point.x = coord_.x + speed_.x * dt_second;
-        end_point.y = coord_.y + speed_.y * dt_second;
+        end_point.x = coord.x + speed.x * dt_second;
+        end_point.y = coord.y + speed.y * dt_second;
         return end_point;
     }
 
@@ -6,6 +6,8 @@
 #include <vector>
 #include <deque>
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include "tagged.h"
@@ -31,6 +33,9 @@ namespace model {
         EAST
     };
 
+    // Обозначение направления в ответах API: "U", "D", "L" или "R"
+    std::string_view DirectionName(Direction dir) noexcept;
+
     struct DPoint {
         bool operator==(const DPoint& p) const {
             return (this->x == p.x && this->y == p.y);
@@ -45,29 +50,37 @@ namespace model {
         double x = 0, y = 0;
     };
 
+    // Горячие поля собак игровой сессии, разложенные по массивам (structure of arrays).
+    // Тик перебирает только их, а имена и id лежат отдельно в Dog
+    struct DogStates {
+        std::vector<DCoord> x;
+        std::vector<DCoord> y;
+        std::vector<double> speed_x;
+        std::vector<double> speed_y;
+        std::vector<Direction> dir;
+        std::vector<uint8_t> moving;
+
+        size_t Size() const noexcept {
+            return x.size();
+        }
+        size_t Add(DPoint coord);
+        void PopBack();
+        void SetSpeed(size_t index, DSpeed speed);
+    };
+
+    // end = pos + speed * dt для всех собак. На x86 используется AVX2 (если он есть у процессора) или SSE2,
+    // иначе скалярный цикл. Результат совпадает со скалярным вычислением бит в бит
+    void IntegrateMovement(const DogStates& states, std::chrono::milliseconds move_time_ms, DCoord* end_x, DCoord* end_y);
+
+    // Холодная часть собаки: id, кличка и индекс её горячих полей в DogStates сессии
     class Dog {
     public:
         using Id = util::Tagged<uint64_t, Dog>;
-        Dog(std::string_view nickname, const DPoint& coord)
+        Dog(std::string_view nickname, size_t index, DogStates* states)
             : id_(Id{ idn++ })
             , nickname_(nickname.data(), nickname.size())
-            , coord_(coord)
-            , speed_(zero_speed_)
-            , dir_(Direction::NORTH) {
-        }
-        Dog(const Dog& other)
-            : id_(other.id_)
-            , nickname_(other.nickname_)
-            , coord_(other.coord_)
-            , speed_(other.speed_)
-            , dir_(other.dir_) {
-        }
-        Dog(Dog&& other) noexcept
-            : id_(std::move(other.id_))
-            , nickname_(std::move(other.nickname_))
-            , coord_(std::move(other.coord_))
-            , speed_(std::move(other.speed_))
-            , dir_(std::move(other.dir_)) {
+            , index_(index)
+            , states_(states) {
         }
         const Id& GetId() const {
             return id_;
@@ -75,32 +88,39 @@ namespace model {
         std::string_view GetName() const noexcept {
             return nickname_;
         }
-        const DPoint& GetPoint() const {
-            return coord_;
+        // Индекс горячих полей собаки в DogStates сессии (он же индекс в GameSession::GetDogs())
+        size_t GetIndex() const noexcept {
+            return index_;
+        }
+        Direction GetDir() const {
+            return states_->dir[index_];
+        }
+        DPoint GetPoint() const {
+            return { states_->x[index_], states_->y[index_] };
         }
-        const DSpeed& GetSpeed() const {
-            return speed_;
+        DSpeed GetSpeed() const {
+            return { states_->speed_x[index_], states_->speed_y[index_] };
         }
         std::string GetDirection() const;
         void Diraction(Move move, DDimension speed);
-        DPoint GetEndPoint(std::chrono::milliseconds move_time_ms);
+        DPoint GetEndPoint(std::chrono::milliseconds move_time_ms) const;
         void SetPoint(DPoint coord) {
-            coord_ = coord;
+            states_->x[index_] = coord.x;
+            states_->y[index_] = coord.y;
         }
         bool IsStanding() const {
-            return speed_ == zero_speed_;
+            return !states_->moving[index_];
         }
         void Stop() {
-            speed_ = zero_speed_;
+            states_->SetSpeed(index_, zero_speed_);
         }
     private:
         static std::atomic<uint64_t> idn;
         static DSpeed zero_speed_;
         Id id_ = Id{0};
         std::string nickname_ = "";
-        DPoint coord_;
-        DSpeed speed_ = zero_speed_;
-        Direction dir_ = Direction::NORTH;
+        size_t index_ = 0;
+        DogStates* states_ = nullptr;
     };
 
 } //namespace model
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace util {
+
+    namespace detail {
+
+        inline constexpr char HEX_DIGITS[] = "0123456789abcdef";
+
+        // Значение шестнадцатеричной цифры по коду символа, -1 для остальных символов
+        inline constexpr std::array<int8_t, 256> HEX_VALUES = [] {
+            std::array<int8_t, 256> values{};
+            values.fill(-1);
+            for (int i = 0; i < 10; ++i) {
+                values['0' + i] = static_cast<int8_t>(i);
+            }
+            for (int i = 0; i < 6; ++i) {
+                values['a' + i] = static_cast<int8_t>(10 + i);
+                values['A' + i] = static_cast<int8_t>(10 + i);
+            }
+            return values;
+        }();
+
+    } //namespace detail
+
+    inline constexpr size_t HEX64_SIZE = 16;
+
+    // Записывает n ровно 16 строчными шестнадцатеричными цифрами с ведущими нулями
+    inline void WriteHex64(uint64_t n, char* out) noexcept {
+        for (size_t i = HEX64_SIZE; i > 0; --i) {
+            out[i - 1] = detail::HEX_DIGITS[n & 0xF];
+            n >>= 4;
+        }
+    }
+
+    // Разбирает ровно 16 шестнадцатеричных цифр (в любом регистре)
+    inline std::optional<uint64_t> ParseHex64(std::string_view text) noexcept {
+        if (text.size() != HEX64_SIZE) {
+            return std::nullopt;
+        }
+        uint64_t n = 0;
+        for (char c : text) {
+            const int8_t v = detail::HEX_VALUES[static_cast<unsigned char>(c)];
+            if (v < 0) {
+                return std::nullopt;
+            }
+            n = (n << 4) | static_cast<uint64_t>(v);
+        }
+        return n;
+    }
+
+} //namespace util
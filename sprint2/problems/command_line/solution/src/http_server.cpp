@@ -7,69 +7,278 @@ namespace http_server {
 
     std::string uriDecode(std::string_view src) {
         std::string ret;
-        char ch;
-        int i, ii;
-        for (i = 0; i < src.length(); i++) {
-            if (src[i] == '%') {
-                [[maybe_unused]] auto s = sscanf(src.substr(i + 1, 2).data(), "%x", &ii);
-                ch = static_cast<char>(ii);
-                ret += ch;
-                i = i + 2;
-            }
-            else if (src[i] == '+') {
-                ret += ' ';
-                i = i + 1;
-            }
-            else if (src[i] >= 'A' && src[i] <= 'Z') {
-                ret += src[i] - 'A' + 'a';
-            }
-            else {
-                ret += src[i];
-            }
-        }
+        UriDecode(src, ret);
         return ret;
     }
 
     void SessionBase::Run() {
+        // Ответы на конвейер уходят несколькими записями подряд, алгоритм Нейгла задерживал бы вторую из них
+        sys::error_code ec;
+        stream_.socket().set_option(tcp::no_delay(true), ec);
+        // Beast читает из сокета не больше свободной ёмкости буфера: с запасом весь конвейер читается за один вызов
+        buffer_.reserve(READ_BUFFER_SIZE);
         net::dispatch(stream_.get_executor(), beast::bind_front_handler(&SessionBase::Read, GetSharedThis()));
     }
 
+    SessionBase::~SessionBase() {
+        // Арена не вызывает деструкторов, а в неотправленных ответах остаются тела, общие буферы и открытые файлы
+        for (auto& slot : pipeline_) {
+            DestroyResponse(slot);
+        }
+    }
+
     void SessionBase::Read() {
         using namespace std::literals;
-        request_ = {};
+        PrepareParser();
+        reading_ = true;
         stream_.expires_after(30s);
-        http::async_read(stream_, buffer_, request_, beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+        http::async_read(stream_, buffer_, *parser_, beast::bind_front_handler(&SessionBase::OnRead, GetSharedThis()));
+    }
+
+    void SessionBase::PrepareParser() {
+        // Парсер недочитанного запроса продолжает работу с теми байтами, на которых остановился
+        if (parser_) {
+            return;
+        }
+        if (!read_arena_) {
+            read_arena_ = AcquireArena();
+        }
+        ArenaAllocator alloc{&read_arena_->resource};
+        parser_.emplace(std::piecewise_construct, std::make_tuple(alloc), std::make_tuple(alloc));
     }
 
     void SessionBase::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        reading_ = false;
+        if (ec || aborted_) {
+            return StopReading(ec);
+        }
+        // Запросы, которые клиент прислал пачкой, уже лежат в buffer_: они передаются обработчикам здесь же,
+        // и только потом решается, что записывать. Read ставится после Flush: чтение разбирает буфер сразу
+        handling_ = true;
+        do {
+            HandleParsed();
+        } while (!read_stopped_ && pipeline_.size() < MAX_PIPELINE_DEPTH && ParseBuffered(ec));
+        handling_ = false;
+        if (ec) {
+            return StopReading(ec);
+        }
+        Flush();
+        if (!aborted_ && !read_stopped_ && !reading_ && pipeline_.size() < MAX_PIPELINE_DEPTH) {
+            Read();
+        }
+    }
+
+    bool SessionBase::ParseBuffered(beast::error_code& ec) {
+        if (buffer_.size() == 0) {
+            return false;
+        }
+        PrepareParser();
+        parser_->eager(true);
+        while (buffer_.size() > 0 && !parser_->is_done()) {
+            buffer_.consume(parser_->put(buffer_.data(), ec));
+            if (ec == http::error::need_more) {
+                ec = {};
+                return false;
+            }
+            if (ec) {
+                return false;
+            }
+        }
+        return parser_->is_done();
+    }
+
+    void SessionBase::HandleParsed() {
         using namespace std::literals;
+        // Арена прочитанного запроса переходит к его слоту и освобождается, когда на запрос отправлен ответ
+        auto& slot = pipeline_.emplace_back(std::move(read_arena_));
+        const std::size_t seq = first_seq_ + pipeline_.size() - 1;
+        auto& request = parser_->get();
+        // Цель раскодируется один раз: та же строка идёт в лог и в обработчик
+        UriDecode(request.target(), slot.target);
+        auto rmeth = http::to_string(request.method());
+        // Запрос мог остаться в буфере после того, как клиент сбросил соединение: тогда адреса уже нет
+        sys::error_code endpoint_ec;
+        const auto endpoint = stream_.socket().remote_endpoint(endpoint_ec);
+        LOGSRV().Request(endpoint_ec ? ""s : endpoint.address().to_string(), slot.target, std::string_view(rmeth.data(), rmeth.size()));
+        read_stopped_ = request.need_eof();
+        slot.start_time = steady_clock::now();
+        if (websocket::is_upgrade(request)) {
+            // После Upgrade по соединению больше не будет HTTP-запросов
+            read_stopped_ = true;
+            slot.upgrade_request = std::make_unique<WebSocketSession::UpgradeRequest>(request.method(), request.target(), request.version());
+            for (const auto& field : request) {
+                slot.upgrade_request->insert(field.name_string(), field.value());
+            }
+        }
+        // Запрос уничтожается при выходе из функции, пока слот с его ареной гарантированно на месте
+        HttpRequest released = parser_->release();
+        parser_.reset();
+        HandleRequest(std::move(released), slot.target, seq);
+    }
+
+    void SessionBase::StopReading(beast::error_code ec) {
+        // Недочитанный запрос больше не нужен, арена остаётся для следующего чтения
+        parser_.reset();
+        if (read_arena_) {
+            read_arena_->resource.release();
+        }
+        read_stopped_ = true;
         if (ec == http::error::end_of_stream) {
-            return Close();
+            if (pipeline_.empty()) {
+                Close();
+            }
         }
-        if (ec) {
+        else if (ec) {
             LOGSRV().Error(ec, server_logging::Server::Where::read);
+            Abort();
+        }
+    }
+
+    void SessionBase::Flush() {
+        // Во время OnRead синхронные ответы копятся: OnRead сам вызовет Flush, когда передаст обработчикам
+        // все полученные запросы, и ответы на пачку уйдут вместе
+        if (aborted_ || writing_ || handling_) {
             return;
         }
-        std::string uri = uriDecode(request_.target());
-        auto rmeth = http::to_string(request_.method());
-        LOGSRV().Request(stream_.socket().remote_endpoint().address().to_string(), uri, std::string_view(rmeth.data(), rmeth.size()));
-        start_time_ = steady_clock::now();
-        HandleRequest(std::move(request_));
+        write_buffers_.clear();
+        batch_size_ = 0;
+        for (const auto& slot : pipeline_) {
+            if (slot.response == nullptr) {
+                break;
+            }
+            beast::error_code ec;
+            slot.response->Prepare(write_buffers_, ec);
+            if (ec) {
+                LOGSRV().Error(ec, server_logging::Server::Where::write);
+                return Close();
+            }
+            ++batch_size_;
+            // Файл отправляется порциями, следующие ответы ждут, пока он не уйдёт целиком
+            if (!slot.response->IsBuffered() || slot.response->NeedEof()) {
+                break;
+            }
+        }
+        if (batch_size_ == 0) {
+            if (!pipeline_.empty() && pipeline_.front().upgrade) {
+                StartWebSocket();
+            }
+            return;
+        }
+        writing_ = true;
+        // net::async_write отдаёт ядру не больше 16 буферов за вызов, а у ответа их около семи, так что пачка
+        // разошлась бы на несколько sendmsg. async_write_some передаёт до 64 буферов одним вызовом; если ядро
+        // приняло не всё, OnWrite учитывает отправленное, и остаток уходит следующим Flush
+        stream_.async_write_some(write_buffers_, beast::bind_front_handler(&SessionBase::OnWrite, GetSharedThis()));
     }
 
-    void SessionBase::OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+    void SessionBase::OnWrite(beast::error_code ec, std::size_t bytes_written) {
+        writing_ = false;
         if (ec) {
             LOGSRV().Error(ec, server_logging::Server::Where::write);
-            return;
+            return Abort();
+        }
+        if (aborted_) {
+            // Соединение оборвалось, пока шла запись: теперь можно уничтожить и отправленную пачку
+            return Abort();
+        }
+        for (std::size_t i = 0; i < batch_size_; ++i) {
+            auto& slot = pipeline_.front();
+            bytes_written -= slot.response->Consume(bytes_written);
+            if (!slot.response->IsDone()) {
+                break;
+            }
+            const bool close = slot.response->NeedEof();
+            PopFront();
+            if (close) {
+                return Close();
+            }
+        }
+        if (read_stopped_ && pipeline_.empty()) {
+            return Close();
+        }
+        Flush();
+        if (!aborted_ && !read_stopped_ && !reading_ && pipeline_.size() < MAX_PIPELINE_DEPTH) {
+            Read();
+        }
+    }
+
+    void SessionBase::EnqueueUpgrade(std::size_t seq, WebSocketUpgrade&& upgrade) {
+        auto& slot = pipeline_[seq - first_seq_];
+        auto time = steady_clock::now() - slot.start_time;
+        LOGSRV().Response(std::chrono::round<milliseconds>(time).count(), static_cast<unsigned>(http::status::switching_protocols), ""sv);
+        slot.answered = true;
+        if (aborted_) {
+            return PopAnswered();
         }
-        if (close) {
+        slot.upgrade = std::move(upgrade);
+        Flush();
+    }
+
+    void SessionBase::StartWebSocket() {
+        auto slot = std::move(pipeline_.front());
+        pipeline_.pop_front();
+        ++first_seq_;
+        if (!slot.upgrade_request) {
+            // Обработчик не должен отвечать Upgrade на обычный запрос
             return Close();
         }
-        Read();
+        // Клиент мог отправить первые кадры вместе с рукопожатием: они уже прочитаны в buffer_
+        std::string buffered = beast::buffers_to_string(buffer_.data());
+        buffer_.consume(buffer_.size());
+        std::make_shared<WebSocketSession>(std::move(stream_))->Run(std::move(*slot.upgrade_request), std::move(buffered), std::move(slot.upgrade->on_open));
     }
 
     void SessionBase::Close() {
-        stream_.socket().shutdown(tcp::socket::shutdown_send);
+        sys::error_code ec;
+        stream_.socket().shutdown(tcp::socket::shutdown_send, ec);
+        // Ответы, стоящие после закрывающего, уже не будут отправлены
+        Abort();
+    }
+
+    void SessionBase::Abort() {
+        aborted_ = true;
+        // Первые batch_size_ ответов ещё отправляет незавершённая запись: их уничтожит OnWrite
+        for (std::size_t i = writing_ ? batch_size_ : 0; i < pipeline_.size(); ++i) {
+            DestroyResponse(pipeline_[i]);
+        }
+        PopAnswered();
+    }
+
+    std::unique_ptr<SessionBase::Arena> SessionBase::AcquireArena() {
+        if (free_arenas_.empty()) {
+            return std::make_unique<Arena>();
+        }
+        auto arena = std::move(free_arenas_.back());
+        free_arenas_.pop_back();
+        return arena;
+    }
+
+    void SessionBase::DestroyResponse(PipelineSlot& slot) noexcept {
+        if (slot.response != nullptr) {
+            std::destroy_at(slot.response);
+            slot.response = nullptr;
+        }
+    }
+
+    void SessionBase::PopFront() {
+        auto& slot = pipeline_.front();
+        DestroyResponse(slot);
+        auto arena = std::move(slot.arena);
+        pipeline_.pop_front();
+        ++first_seq_;
+        arena->resource.release();
+        free_arenas_.push_back(std::move(arena));
+    }
+
+    void SessionBase::PopAnswered() {
+        // Слот без ответа ждёт обработчика: его запрос ещё лежит в арене слота.
+        // Во время OnRead запрос, на который уже ответили, может ещё жить у вызывающей стороны
+        if (writing_ || handling_) {
+            return;
+        }
+        while (!pipeline_.empty() && pipeline_.front().answered) {
+            PopFront();
+        }
     }
 
 } //namespace http_server
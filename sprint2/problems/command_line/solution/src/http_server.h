@@ -1,12 +1,25 @@
 #pragma once
 #include "sdk.h"
 
+#include <boost/asio/dispatch.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 #include "log.h"
+#include "websocket_session.h"
 
 namespace http_server {
 
@@ -18,8 +31,136 @@ namespace http_server {
     using namespace std::literals;
     using namespace std::chrono;
 
+    // Запрос целиком (поля и тело) размещается в арене своего обмена, которая сбрасывается после отправки ответа.
+    // В арене живут только парсер, запрос, раскодированная цель и оболочка ответа (см. PendingResponse). Поля и тело
+    // ответа обработчик создаёт в обычной куче: все типы ответов обработчиков пользуются стандартным аллокатором.
+    // Так что запрос без выделений не обходится: остаются выделения под заголовки и тело ответа
+    using ArenaAllocator = std::pmr::polymorphic_allocator<char>;
+    using RequestBody = http::basic_string_body<char, std::char_traits<char>, ArenaAllocator>;
+    using Request = http::request<RequestBody, http::basic_fields<ArenaAllocator>>;
+
+    namespace detail {
+
+        constexpr int HexDigit(char c) noexcept {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F') {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+    } //namespace detail
+
+    // Раскодирует %XX и '+', приводит латиницу к нижнему регистру. Результат пишется в out (std::string
+    // или std::pmr::string), его ёмкость переиспользуется
+    template <typename String>
+    void UriDecode(std::string_view src, String& out) {
+        out.clear();
+        out.reserve(src.size());
+        for (size_t i = 0; i < src.size(); ++i) {
+            const char c = src[i];
+            if (c == '%' && i + 2 < src.size()) {
+                const int hi = detail::HexDigit(src[i + 1]);
+                const int lo = detail::HexDigit(src[i + 2]);
+                if (hi >= 0 && lo >= 0) {
+                    out += static_cast<char>(hi * 16 + lo);
+                    i += 2;
+                    continue;
+                }
+                out += c;
+            }
+            else if (c == '+') {
+                out += ' ';
+            }
+            else if (c >= 'A' && c <= 'Z') {
+                out += static_cast<char>(c - 'A' + 'a');
+            }
+            else {
+                out += c;
+            }
+        }
+    }
     std::string uriDecode(std::string_view src);
 
+#ifdef SO_REUSEPORT
+    // Позволяет нескольким акцепторам слушать один и тот же порт (ядро балансирует подключения между ними)
+    using reuse_port = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+
+    // Ответ, ожидающий отправки в конвейере соединения. Сериализатор ссылается на сообщение,
+    // поэтому объект не перемещается и до конца отправки живёт в арене своего обмена. В арене лежит только
+    // оболочка - сообщение и сериализатор; память полей и тела принадлежит самому ответу
+    class PendingResponse {
+    public:
+        virtual ~PendingResponse() = default;
+        // Дописывает в out буферы очередной порции ответа
+        virtual void Prepare(std::vector<net::const_buffer>& out, beast::error_code& ec) = 0;
+        // Отмечает отправленными не более available байт подготовленной порции, возвращает их число
+        virtual std::size_t Consume(std::size_t available) = 0;
+        virtual bool IsDone() = 0;
+        // Тело целиком в памяти: заголовок и тело уходят одной порцией
+        virtual bool IsBuffered() const = 0;
+        virtual bool NeedEof() const = 0;
+    };
+
+    template <typename Body, typename Fields>
+    class PendingResponseImpl final : public PendingResponse {
+    public:
+        explicit PendingResponseImpl(http::response<Body, Fields>&& response)
+            : response_(std::move(response))
+            , serializer_(response_) {
+        }
+
+        void Prepare(std::vector<net::const_buffer>& out, beast::error_code& ec) override {
+            prepared_ = 0;
+            serializer_.next(ec, [this, &out](beast::error_code&, const auto& buffers) {
+                for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it) {
+                    const net::const_buffer buffer = *it;
+                    out.push_back(buffer);
+                    prepared_ += buffer.size();
+                }
+            });
+        }
+
+        std::size_t Consume(std::size_t available) override {
+            const std::size_t consumed = std::min(available, prepared_);
+            serializer_.consume(consumed);
+            prepared_ = 0;
+            return consumed;
+        }
+
+        bool IsDone() override {
+            // Ответ без тела завершается ещё одним вызовом next, который не отдаёт буферов
+            if (!serializer_.is_done()) {
+                beast::error_code ec;
+                serializer_.next(ec, [](beast::error_code&, const auto&) {});
+            }
+            return serializer_.is_done();
+        }
+
+        bool IsBuffered() const override {
+            return !std::is_same_v<Body, http::file_body>;
+        }
+
+        bool NeedEof() const override {
+            return response_.need_eof();
+        }
+
+    private:
+        http::response<Body, Fields> response_;
+        http::response_serializer<Body, Fields> serializer_;
+        std::size_t prepared_ = 0;
+    };
+
+    // Соединение поддерживает конвейер HTTP/1.1: следующий запрос читается, не дожидаясь ответа на предыдущий.
+    // Ответы отправляются в порядке запросов. Запросы, которые уже целиком лежат в буфере чтения, передаются
+    // обработчикам до записи, поэтому синхронные ответы на всю пачку уходят одной gather-записью.
+    // Запрос Upgrade: websocket завершает конвейер: после ответов на предыдущие запросы сокет передаётся WebSocketSession
     class SessionBase {
     public:
         SessionBase(const SessionBase&) = delete;
@@ -27,35 +168,124 @@ namespace http_server {
         void Run();
 
     protected:
-        using HttpRequest = http::request<http::string_body>;
+        using HttpRequest = Request;
         explicit SessionBase(tcp::socket&& socket) : stream_(std::move(socket)) {}
 
+        // seq - номер запроса, на который дан ответ. Может вызываться из любого strand
         template <typename Body, typename Fields>
-        void Write(http::response<Body, Fields>&& response) {
-            auto time = steady_clock::now() - start_time_;
-            LOGSRV().Response(std::chrono::round<milliseconds>(time).count(), response.result_int(), response[http::field::content_type]);
-            auto safe_response = std::make_shared<http::response<Body, Fields>>(std::move(response));
-            auto self = GetSharedThis();
-            http::async_write(stream_, *safe_response,
-                              [safe_response, self](beast::error_code ec, std::size_t bytes_written) {
-                                  self->OnWrite(safe_response->need_eof(), ec, bytes_written);
-                              }
-            );
-        }
-        virtual ~SessionBase() = default;
+        void Write(std::size_t seq, http::response<Body, Fields>&& response) {
+            net::dispatch(stream_.get_executor(), [self = GetSharedThis(), seq, response = std::move(response)]() mutable {
+                self->Enqueue(seq, std::move(response));
+            });
+        }
+        void Write(std::size_t seq, WebSocketUpgrade&& upgrade) {
+            net::dispatch(stream_.get_executor(), [self = GetSharedThis(), seq, upgrade = std::move(upgrade)]() mutable {
+                self->EnqueueUpgrade(seq, std::move(upgrade));
+            });
+        }
+        virtual ~SessionBase();
     private:
+        static constexpr std::size_t ARENA_SIZE = 8 * 1024;
+        static constexpr std::size_t MAX_PIPELINE_DEPTH = 16;
+        static constexpr std::size_t READ_BUFFER_SIZE = 8 * 1024;
+
+        // Арена одного обмена запрос-ответ: парсер, запрос, цель и оболочка ответа. Первые ARENA_SIZE байт
+        // лежат в самой арене, при переполнении память берётся из кучи и возвращается при сбросе
+        struct Arena {
+            alignas(std::max_align_t) std::array<std::byte, ARENA_SIZE> buffer;
+            std::pmr::monotonic_buffer_resource resource{buffer.data(), buffer.size()};
+        };
+
+        struct PipelineSlot {
+            explicit PipelineSlot(std::unique_ptr<Arena> arena)
+                : arena(std::move(arena))
+                , target(&this->arena->resource) {
+            }
+            // Объявлена первой, чтобы пережить всё, что в ней размещено
+            std::unique_ptr<Arena> arena;
+            // Раскодированная цель запроса. Обработчик получает её как string_view: строка не меняется,
+            // пока ответ не отправлен
+            std::pmr::string target;
+            // Размещён в arena. nullptr, пока обработчик не ответил, и после того как ответ уничтожен
+            PendingResponse* response = nullptr;
+            // Обработчик ответил: запрос, лежащий в arena, им уже уничтожен
+            bool answered = false;
+            steady_clock::time_point start_time;
+            // Заголовки запроса на Upgrade, скопированные из арены для рукопожатия WebSocket
+            std::unique_ptr<WebSocketSession::UpgradeRequest> upgrade_request;
+            std::optional<WebSocketUpgrade> upgrade;
+        };
+
         beast::tcp_stream stream_;
         beast::flat_buffer buffer_;
-        HttpRequest request_;
-        steady_clock::time_point start_time_;
+        // Арена читаемого запроса. После чтения она переходит в слот конвейера, а когда ответ отправлен,
+        // сбрасывается и возвращается в free_arenas_. Так память каждого обмена освобождается вместе с ним,
+        // а keep-alive соединение в установившемся режиме обходится парой арен
+        std::unique_ptr<Arena> read_arena_;
+        std::vector<std::unique_ptr<Arena>> free_arenas_;
+        std::optional<http::request_parser<RequestBody, ArenaAllocator>> parser_;
+
+        std::deque<PipelineSlot> pipeline_;
+        // Номер запроса в pipeline_.front()
+        std::size_t first_seq_ = 0;
+        std::vector<net::const_buffer> write_buffers_;
+        std::size_t batch_size_ = 0;
+        bool reading_ = false;
+        bool writing_ = false;
+        // OnRead передаёт запросы обработчикам. Запросы и их цели лежат в аренах слотов, поэтому пока флаг
+        // поднят, слоты не снимаются с конвейера, а запись откладывается до конца OnRead
+        bool handling_ = false;
+        // Клиент закрыл соединение или запросил Connection: close - новых запросов не будет
+        bool read_stopped_ = false;
+        // Соединение оборвано или закрыто: ответы больше не отправляются, а уничтожаются, как только готовы
+        bool aborted_ = false;
 
         virtual std::shared_ptr<SessionBase> GetSharedThis() = 0;
         void Read();
         void OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read);
-        void OnWrite(bool close, beast::error_code ec, [[maybe_unused]] std::size_t bytes_written);
+        // Создаёт парсер в арене читаемого запроса, если его ещё нет
+        void PrepareParser();
+        // Разбирает следующий запрос из уже полученных байт, не обращаясь к сокету.
+        // true, если запрос получен целиком; недочитанный запрос остаётся в парсере для следующего Read
+        bool ParseBuffered(beast::error_code& ec);
+        // Ставит разобранный запрос в конвейер и передаёт его обработчику
+        void HandleParsed();
+        void StopReading(beast::error_code ec);
+        void Flush();
+        void OnWrite(beast::error_code ec, std::size_t bytes_written);
+        void EnqueueUpgrade(std::size_t seq, WebSocketUpgrade&& upgrade);
+        void StartWebSocket();
         void Close();
+        void Abort();
+        std::unique_ptr<Arena> AcquireArena();
+        // Уничтожает ответ слота (если он есть), не снимая слот с конвейера
+        static void DestroyResponse(PipelineSlot& slot) noexcept;
+        // Снимает с конвейера первый слот и возвращает его арену в пул
+        void PopFront();
+        // После Abort снимает с начала конвейера слоты, на которые обработчик уже ответил.
+        // Ничего не делает, пока идёт запись или OnRead передаёт запросы обработчикам
+        void PopAnswered();
 
-        virtual void HandleRequest(HttpRequest&& request) = 0;
+        template <typename Body, typename Fields>
+        void Enqueue(std::size_t seq, http::response<Body, Fields>&& response) {
+            using Pending = PendingResponseImpl<Body, Fields>;
+            auto& slot = pipeline_[seq - first_seq_];
+            auto time = steady_clock::now() - slot.start_time;
+            LOGSRV().Response(std::chrono::round<milliseconds>(time).count(), response.result_int(), response[http::field::content_type]);
+            slot.answered = true;
+            if (aborted_) {
+                // Отправлять некуда: ответ уничтожается вместе с аргументом
+                return PopAnswered();
+            }
+            std::pmr::polymorphic_allocator<Pending> alloc{&slot.arena->resource};
+            Pending* pending = alloc.allocate(1);
+            std::construct_at(pending, std::move(response));
+            slot.response = pending;
+            Flush();
+        }
+
+        // target - раскодированная цель запроса, действительна до отправки ответа на него
+        virtual void HandleRequest(HttpRequest&& request, std::string_view target, std::size_t seq) = 0;
     };
 
     template <typename RequestHandler>
@@ -71,10 +301,10 @@ namespace http_server {
         std::shared_ptr<SessionBase> GetSharedThis() override {
             return this->shared_from_this();
         }
-        void HandleRequest(HttpRequest&& request) override {
+        void HandleRequest(HttpRequest&& request, std::string_view target, std::size_t seq) override {
             tcp::endpoint ep;
-            request_handler_(ep, std::move(request), [self = this->shared_from_this()](auto&& response) {
-                self->Write(std::move(response));
+            request_handler_(ep, std::move(request), target, [self = this->shared_from_this(), seq](auto&& response) {
+                self->Write(seq, std::move(response));
             });
         }
     };
@@ -82,13 +312,23 @@ namespace http_server {
     template <typename RequestHandler>
     class Listener : public std::enable_shared_from_this<Listener<RequestHandler>> {
     public:
+        // sharded == true: io_context обслуживается ровно одним потоком, поэтому strand не нужен,
+        // а порт открывается с SO_REUSEPORT, чтобы у каждого шарда был свой акцептор
         template <typename Handler>
-        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler)
+        Listener(net::io_context& ioc, const tcp::endpoint& endpoint, Handler&& request_handler, bool sharded = false)
             : ioc_(ioc)
-            , acceptor_(net::make_strand(ioc))
+            , sharded_(sharded)
+            , acceptor_(MakeExecutor())
             , request_handler_(std::forward<Handler>(request_handler)) {
             acceptor_.open(endpoint.protocol());
             acceptor_.set_option(net::socket_base::reuse_address(true));
+            if (sharded_) {
+#ifdef SO_REUSEPORT
+                acceptor_.set_option(reuse_port(true));
+#else
+                throw std::runtime_error("Sharded mode requires SO_REUSEPORT support"s);
+#endif
+            }
             acceptor_.bind(endpoint);
             acceptor_.listen(net::socket_base::max_listen_connections);
         }
@@ -98,12 +338,20 @@ namespace http_server {
         }
     private:
         net::io_context& ioc_;
+        const bool sharded_;
         tcp::acceptor acceptor_;
         RequestHandler request_handler_;
 
+        net::any_io_executor MakeExecutor() {
+            if (sharded_) {
+                return ioc_.get_executor();
+            }
+            return net::make_strand(ioc_);
+        }
+
         void DoAccept() {
             acceptor_.async_accept(
-                net::make_strand(ioc_),
+                MakeExecutor(),
                 beast::bind_front_handler(&Listener::OnAccept, this->shared_from_this()));
         }
 
@@ -128,4 +376,11 @@ namespace http_server {
         std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler))->Run();
     }
 
+    // Запускает отдельный акцептор на io_context шарда; вызывается для каждого шарда с одним и тем же endpoint
+    template <typename RequestHandler>
+    void ServerHttpSharded(net::io_context& ioc, const tcp::endpoint& endpoint, RequestHandler&& handler) {
+        using MyListener = Listener<std::decay_t<RequestHandler>>;
+        std::make_shared<MyListener>(ioc, endpoint, std::forward<RequestHandler>(handler), true)->Run();
+    }
+
 } //namespace http_server
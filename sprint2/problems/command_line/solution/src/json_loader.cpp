@@ -1,93 +1,148 @@
 #include "json_loader.h"
-#include "boost/property_tree/ptree.hpp"
-#include "boost/property_tree/json_parser.hpp"
-#include "boost/foreach.hpp"
+#include <boost/json.hpp>
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
 #include <string>
-#include <iostream>
+#include <thread>
+#include <vector>
 
 namespace json_loader {
 
-    using namespace boost::property_tree;
+    using namespace std::literals;
     namespace fs = std::filesystem;
+    namespace js = boost::json;
 
-    model::Road LoadRoad(ptree &ptreeRoad, model::DDimension road_offset) {
-        model::Point start;
-        if (ptreeRoad.to_iterator(ptreeRoad.find("y1")) == ptreeRoad.end()) {
-            start.x = ptreeRoad.get<int>("x0");
-            start.y = ptreeRoad.get<int>("y0");
-            return model::Road(model::Road::HORIZONTAL, start, ptreeRoad.get<int>("x1"), road_offset);
+    namespace {
+
+        // Меньше карт на поток не окупают запуск потока
+        constexpr size_t MIN_MAPS_PER_THREAD = 64;
+
+        std::string ReadFile(const fs::path& json_path) {
+            std::ifstream file(json_path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Json file read error: can't open "s + json_path.string());
+            }
+            return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        }
+
+        std::string ToString(const js::value& value) {
+            const auto& str = value.as_string();
+            return std::string(str.data(), str.size());
+        }
+
+        int GetInt(const js::object& obj, std::string_view key) {
+            return obj.at(key).to_number<int>();
+        }
+
+    } //namespace
+
+    model::Road LoadRoad(const js::object& jroad, model::DDimension road_offset) {
+        const model::Point start{.x = GetInt(jroad, "x0"sv), .y = GetInt(jroad, "y0"sv)};
+        if (const auto* y1 = jroad.if_contains("y1"sv)) {
+            return model::Road(model::Road::VERTICAL, start, y1->to_number<int>(), road_offset);
         }
-        start.x = ptreeRoad.get<int>("x0");
-        start.y = ptreeRoad.get<int>("y0");
-        return model::Road(model::Road::VERTICAL, start, ptreeRoad.get<int>("y1"), road_offset);
+        return model::Road(model::Road::HORIZONTAL, start, GetInt(jroad, "x1"sv), road_offset);
     }
 
-    model::Building LoadBuilding(ptree &ptB) {
+    model::Building LoadBuilding(const js::object& jbuilding) {
         model::Rectangle r {
-            .position = {.x = ptB.get<int>("x"), .y = ptB.get<int>("y")},
-            .size = {.width = ptB.get<int>("w"), .height = ptB.get<int>("h")}
+            .position = {.x = GetInt(jbuilding, "x"sv), .y = GetInt(jbuilding, "y"sv)},
+            .size = {.width = GetInt(jbuilding, "w"sv), .height = GetInt(jbuilding, "h"sv)}
         };
         return model::Building(r);
     }
 
-    model::Office LoadOffice(ptree &ptO) {
-        model::Office::Id idO{ptO.get<std::string>("id")};
+    model::Office LoadOffice(const js::object& joffice) {
         return model::Office(
-            idO,
-            model::Point{.x = ptO.get<int>("x"), .y = ptO.get<int>("y")},
-            model::Offset{.dx = ptO.get<int>("offsetX"), .dy = ptO.get<int>("offsetY")}
+            model::Office::Id{ToString(joffice.at("id"sv))},
+            model::Point{.x = GetInt(joffice, "x"sv), .y = GetInt(joffice, "y"sv)},
+            model::Offset{.dx = GetInt(joffice, "offsetX"sv), .dy = GetInt(joffice, "offsetY"sv)}
         );
     }
 
-    model::Map LoadMap(ptree &ptreeMap, double def_dog_speed) {
-        auto id   = ptreeMap.get<std::string>("id");
-        auto name = ptreeMap.get<std::string>("name");
-        double dog_speed;
-        if (ptreeMap.to_iterator(ptreeMap.find("dogSpeed")) != ptreeMap.end()) {
-            dog_speed = ptreeMap.get<double>("dogSpeed");
+    model::Map LoadMap(const js::object& jmap, double def_dog_speed) {
+        double dog_speed = def_dog_speed;
+        if (const auto* jspeed = jmap.if_contains("dogSpeed"sv)) {
+            dog_speed = jspeed->to_number<double>();
+        }
+        model::Map map(model::Map::Id{ToString(jmap.at("id"sv))}, ToString(jmap.at("name"sv)), dog_speed);
+        for (const auto& jroad : jmap.at("roads"sv).as_array()) {
+            map.AddRoad(LoadRoad(jroad.as_object(), map.GetRoadOffset()));
+        }
+        for (const auto& jbuilding : jmap.at("buildings"sv).as_array()) {
+            map.AddBuilding(LoadBuilding(jbuilding.as_object()));
         }
-        else {
-            dog_speed = def_dog_speed;
+        for (const auto& joffice : jmap.at("offices"sv).as_array()) {
+            map.AddOffice(LoadOffice(joffice.as_object()));
         }
-        model::Map::Id idmap{id};
-        model::Map map(idmap, name, dog_speed);
+        return map;
+    }
 
-        ptree jroads = ptreeMap.get_child("roads");
-        BOOST_FOREACH(ptree::value_type &jroad, jroads) {
-            map.AddRoad(LoadRoad(jroad.second, map.GetRoadOffset()));
+    // Карты не зависят друг от друга, поэтому большой конфиг разбирается несколькими потоками, каждый - свой
+    // непрерывный диапазон карт. Дерево json после разбора только читается, так что общий доступ к нему безопасен.
+    // В игру карты добавляются в исходном порядке, ошибка любой карты пробрасывается вызывающему
+    std::vector<model::Map> LoadMaps(const js::array& jmaps, double def_dog_speed) {
+        const size_t count = jmaps.size();
+        const size_t threads = std::clamp<size_t>(count / MIN_MAPS_PER_THREAD, 1, std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::optional<model::Map>> loaded(count);
+        std::vector<std::exception_ptr> errors(threads);
+        auto load_range = [&](size_t worker) {
+            try {
+                for (size_t i = count * worker / threads, end = count * (worker + 1) / threads; i < end; ++i) {
+                    loaded[i].emplace(LoadMap(jmaps[i].as_object(), def_dog_speed));
+                }
+            }
+            catch (...) {
+                errors[worker] = std::current_exception();
+            }
+        };
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(threads - 1);
+            for (size_t worker = 1; worker < threads; ++worker) {
+                workers.emplace_back(load_range, worker);
+            }
+            load_range(0);
         }
-        ptree jbuildings = ptreeMap.get_child("buildings");
-        BOOST_FOREACH(ptree::value_type &jbuilding, jbuildings) {
-            map.AddBuilding(LoadBuilding(jbuilding.second));
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
+            }
         }
-        ptree joffices = ptreeMap.get_child("offices");
-        BOOST_FOREACH(ptree::value_type &joffice, joffices) {
-            map.AddOffice(LoadOffice(joffice.second));
+        std::vector<model::Map> maps;
+        maps.reserve(count);
+        for (auto& map : loaded) {
+            maps.push_back(std::move(*map));
         }
-        return map;
+        return maps;
     }
 
     model::Game LoadGame(const fs::path& json_path) {
-        model::Game game;
-        ptree pt;
-        try {
-            read_json(json_path.generic_string(), pt);
-        } 
-        catch (ptree_error &e) {
-            std::cout << "Json file read error: " << e.what();
-            throw;
+        const std::string text = ReadFile(json_path);
+        // Всё дерево живёт в одной арене и освобождается разом после загрузки
+        js::monotonic_resource arena;
+        js::error_code ec;
+        const js::value jv = js::parse(js::string_view(text.data(), text.size()), ec, &arena);
+        if (ec) {
+            throw std::runtime_error("Json file read error: "s + ec.message());
         }
+        model::Game game;
         try {
-            auto defDogSpeed = pt.get<double>("defaultDogSpeed");
-            game.SetDefaultDogSpeed(defDogSpeed);
-            ptree jmaps = pt.get_child("maps");
-            BOOST_FOREACH(ptree::value_type &jmap, jmaps) {
-                game.AddMap(LoadMap(jmap.second, defDogSpeed));
+            const auto& jgame = jv.as_object();
+            const auto def_dog_speed = jgame.at("defaultDogSpeed"sv).to_number<double>();
+            game.SetDefaultDogSpeed(def_dog_speed);
+            const auto& jmaps = jgame.at("maps"sv).as_array();
+            game.ReserveMaps(jmaps.size());
+            for (auto& map : LoadMaps(jmaps, def_dog_speed)) {
+                game.AddMap(std::move(map));
             }
         }
-        catch (ptree_error &e) {
-            std::cout << "Json parse ptree error: " << e.what();
-            throw;
+        catch (const std::exception& e) {
+            throw std::runtime_error("Json config error: "s + e.what());
         }
         return game;
     }
@@ -0,0 +1,131 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace util {
+
+    // Потоковая запись JSON прямо в строку-приёмник без промежуточного дерева boost::json.
+    // Запятые расставляются сами, правильность вложенности остаётся на вызывающем.
+    // Числа с плавающей точкой пишутся std::to_chars в кратчайшей точной форме, целые ключи - без временных строк
+    class JsonWriter {
+    public:
+        explicit JsonWriter(std::string& out) : out_(out) {}
+
+        JsonWriter& BeginObject() {
+            Separate();
+            out_.push_back('{');
+            comma_ = false;
+            return *this;
+        }
+        JsonWriter& EndObject() {
+            out_.push_back('}');
+            comma_ = true;
+            return *this;
+        }
+        JsonWriter& BeginArray() {
+            Separate();
+            out_.push_back('[');
+            comma_ = false;
+            return *this;
+        }
+        JsonWriter& EndArray() {
+            out_.push_back(']');
+            comma_ = true;
+            return *this;
+        }
+
+        JsonWriter& Key(std::string_view key) {
+            Separate();
+            WriteString(key);
+            out_.push_back(':');
+            comma_ = false;
+            return *this;
+        }
+        JsonWriter& Key(uint64_t key) {
+            Separate();
+            out_.push_back('"');
+            WriteInteger(key);
+            out_ += "\":";
+            comma_ = false;
+            return *this;
+        }
+
+        JsonWriter& String(std::string_view value) {
+            Separate();
+            WriteString(value);
+            comma_ = true;
+            return *this;
+        }
+        JsonWriter& Number(uint64_t value) {
+            Separate();
+            WriteInteger(value);
+            comma_ = true;
+            return *this;
+        }
+        JsonWriter& Number(double value) {
+            Separate();
+            if (std::isfinite(value)) {
+                char buf[32];
+                auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+                out_.append(buf, end);
+            }
+            else {
+                // В JSON нет бесконечностей и NaN
+                out_ += "null";
+            }
+            comma_ = true;
+            return *this;
+        }
+
+    private:
+        std::string& out_;
+        // Следующему ключу или значению нужна запятая перед ним
+        bool comma_ = false;
+
+        void Separate() {
+            if (comma_) {
+                out_.push_back(',');
+            }
+        }
+
+        void WriteInteger(uint64_t value) {
+            char buf[20];
+            auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+            out_.append(buf, end);
+        }
+
+        void WriteString(std::string_view value) {
+            static constexpr char HEX[] = "0123456789abcdef";
+            out_.push_back('"');
+            size_t plain = 0;
+            for (size_t i = 0; i < value.size(); ++i) {
+                const auto c = static_cast<unsigned char>(value[i]);
+                if (c >= 0x20 && c != '"' && c != '\\') {
+                    continue;
+                }
+                out_.append(value.data() + plain, i - plain);
+                plain = i + 1;
+                out_.push_back('\\');
+                switch (c) {
+                case '"': out_.push_back('"'); break;
+                case '\\': out_.push_back('\\'); break;
+                case '\b': out_.push_back('b'); break;
+                case '\f': out_.push_back('f'); break;
+                case '\n': out_.push_back('n'); break;
+                case '\r': out_.push_back('r'); break;
+                case '\t': out_.push_back('t'); break;
+                default:
+                    out_ += "u00";
+                    out_.push_back(HEX[c >> 4]);
+                    out_.push_back(HEX[c & 0xF]);
+                }
+            }
+            out_.append(value.data() + plain, value.size() - plain);
+            out_.push_back('"');
+        }
+    };
+
+} //namespace util
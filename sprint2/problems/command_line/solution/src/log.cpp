@@ -1,56 +1,235 @@
 #include "log.h"
-#include <boost/log/trivial.hpp>
-#include <boost/log/core.hpp>
-#include <boost/log/expressions.hpp>
-#include <boost/log/utility/setup/file.hpp>
-#include <boost/log/utility/setup/common_attributes.hpp>
-#include <boost/log/utility/setup/console.hpp>
-#include <boost/log/utility/manipulators/add_value.hpp>
+#include "mpsc_ring.h"
 #include <boost/date_time.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string_view>
+#include <thread>
 
 namespace server_logging {
 
     using namespace std::literals;
-    namespace logging = boost::log;
-    namespace keywords = boost::log::keywords;
-    namespace sinks = boost::log::sinks;
-
-    BOOST_LOG_ATTRIBUTE_KEYWORD(line_id, "LineID", uint32_t)
-    BOOST_LOG_ATTRIBUTE_KEYWORD(timestamp, "TimeStamp", boost::posix_time::ptime)
-    BOOST_LOG_ATTRIBUTE_KEYWORD(file, "File", std::string)
-    BOOST_LOG_ATTRIBUTE_KEYWORD(line, "Line", int)
-    BOOST_LOG_ATTRIBUTE_KEYWORD(data, "Data", std::string_view)
-    BOOST_LOG_ATTRIBUTE_KEYWORD(msg, "Msg", std::string_view)
-
-    static void JsonFormatter(logging::record_view const& rec, logging::formatting_ostream& strm) {
-        auto ts = *rec[timestamp];
-        strm << "{\"timestamp\":\"" << to_iso_extended_string(ts) << "\",";
-        strm << "\"data\":" << rec[data] << ",";
-        strm << "\"message\":\"" << rec[msg] << "\"}" << std::endl;
-    }
+    namespace pt = boost::posix_time;
+
+    namespace {
+
+        struct LogRecord {
+            pt::ptime timestamp;
+            std::string data;
+            std::string message;
+        };
+
+        // Фоновый писатель: забирает записи из очереди, форматирует их в JSON-строки и пишет пачками
+        // в файл (с ротацией по размеру и в 12:00) и в консоль, сбрасывая буферы с заданными периодами.
+        // Пустую очередь писатель не опрашивает, а спит на wake_cv_ до новой записи или до ближайшего сброса
+        class AsyncLogWriter {
+        public:
+            explicit AsyncLogWriter(const LogConfig& config)
+                : config_(config)
+                , ring_(config.queue_capacity)
+                , worker_([this] { Run(); }) {
+            }
+
+            ~AsyncLogWriter() {
+                {
+                    std::lock_guard lock{wake_mutex_};
+                    stop_.store(true);
+                }
+                wake_cv_.notify_one();
+                worker_.join();
+            }
+
+            void Push(std::string_view data, std::string_view message) {
+                LogRecord rec{pt::microsec_clock::local_time(), std::string(data), std::string(message)};
+                if (!ring_.TryPush(std::move(rec))) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                // Пока писатель занят, запись обходится без блокировок. Мьютекс берётся, только если он
+                // заснул: либо он ещё проверяет pushed_ под мьютексом и увидит запись, либо уже ждёт и проснётся
+                pushed_.fetch_add(1);
+                if (waiting_.load()) {
+                    std::lock_guard lock{wake_mutex_};
+                    wake_cv_.notify_one();
+                }
+            }
+
+        private:
+            using Clock = std::chrono::steady_clock;
+            static constexpr std::uint64_t ROTATION_SIZE = 10 * 1024 * 1024;
+            static constexpr std::string_view FILE_PATTERN = "/var/log/sample_"sv;
+
+            LogConfig config_;
+            util::MpscRing<LogRecord> ring_;
+            std::atomic<bool> stop_ = false;
+            std::atomic<std::uint64_t> pushed_ = 0;
+            std::atomic<std::uint64_t> dropped_ = 0;
+            std::uint64_t written_ = 0;
+            std::uint64_t reported_dropped_ = 0;
+            std::mutex wake_mutex_;
+            std::condition_variable wake_cv_;
+            std::atomic<bool> waiting_ = false;
+            // Записано, но ещё не сброшено
+            bool console_dirty_ = false;
+            bool file_dirty_ = false;
+
+            std::ofstream file_;
+            unsigned file_index_ = 0;
+            std::uint64_t file_size_ = 0;
+            pt::ptime next_rotation_;
+            std::string batch_;
+            std::jthread worker_;
+
+            void Run() {
+                auto last_file_flush = Clock::now();
+                auto last_console_flush = last_file_flush;
+                OpenFile();
+                for (;;) {
+                    const bool stopping = stop_.load();
+                    const auto seen = pushed_.load();
+                    const bool drained = Drain();
+                    ReportDropped();
+                    WriteBatch();
+                    const auto now = Clock::now();
+                    if (console_dirty_ && (stopping || now - last_console_flush >= config_.console_flush_period)) {
+                        std::cout.flush();
+                        console_dirty_ = false;
+                        last_console_flush = now;
+                    }
+                    if (file_dirty_ && (stopping || now - last_file_flush >= config_.file_flush_period)) {
+                        file_.flush();
+                        file_dirty_ = false;
+                        last_file_flush = now;
+                    }
+                    if (stopping && drained) {
+                        return;
+                    }
+                    if (drained) {
+                        // Несброшенные данные ограничивают сон ближайшим сроком сброса
+                        std::optional<Clock::time_point> deadline;
+                        if (console_dirty_) {
+                            deadline = last_console_flush + config_.console_flush_period;
+                        }
+                        if (file_dirty_) {
+                            deadline = std::min(deadline.value_or(Clock::time_point::max()), last_file_flush + config_.file_flush_period);
+                        }
+                        WaitForRecords(seen, deadline);
+                    }
+                }
+            }
+
+            // Ждёт, пока в очередь не добавят запись после seen-й, не придёт время deadline или не начнётся остановка
+            void WaitForRecords(std::uint64_t seen, std::optional<Clock::time_point> deadline) {
+                std::unique_lock lock{wake_mutex_};
+                waiting_.store(true);
+                const auto woken = [&] {
+                    return stop_.load() || pushed_.load() != seen;
+                };
+                if (deadline) {
+                    wake_cv_.wait_until(lock, *deadline, woken);
+                }
+                else {
+                    wake_cv_.wait(lock, woken);
+                }
+                waiting_.store(false);
+            }
+
+            // Переносит записи из очереди в batch_. Возвращает true, если очередь опустела
+            bool Drain() {
+                static constexpr size_t MAX_BATCH = 4096;
+                LogRecord rec;
+                for (size_t i = 0; i < MAX_BATCH; ++i) {
+                    if (!ring_.TryPop(rec)) {
+                        return true;
+                    }
+                    Format(rec);
+                    ++written_;
+                }
+                return false;
+            }
+
+            void ReportDropped() {
+                const auto dropped = dropped_.load(std::memory_order_relaxed);
+                if (dropped == reported_dropped_) {
+                    return;
+                }
+                json::object obj;
+                obj["dropped"] = dropped - reported_dropped_;
+                // Запись попадает в pushed_ после того, как легла в очередь, и может быть уже прочитана
+                const auto pushed = pushed_.load(std::memory_order_relaxed);
+                obj["queued"] = pushed > written_ ? pushed - written_ : 0;
+                reported_dropped_ = dropped;
+                Format(LogRecord{pt::microsec_clock::local_time(), serialize(obj), "log records dropped"s});
+            }
 
-    void InitBoostLogFilter() {
-        logging::core::get()->set_filter(
-            logging::trivial::severity >= logging::trivial::info
-        );
-        logging::add_common_attributes();
-        logging::add_file_log(
-            keywords::file_name = "/var/log/sample_%N.log",
-            keywords::format = &JsonFormatter,
-            keywords::open_mode = std::ios_base::app | std::ios_base::out,
-            keywords::rotation_size = 10 * 1024 * 1024,
-            keywords::time_based_rotation = sinks::file::rotation_at_time_point(12, 0, 0)
-        );
-        logging::add_console_log(
-            std::cout,
-            keywords::format = &JsonFormatter,
-            keywords::auto_flush = true
-        );
+            void Format(const LogRecord& rec) {
+                batch_ += "{\"timestamp\":\""sv;
+                batch_ += pt::to_iso_extended_string(rec.timestamp);
+                batch_ += "\",\"data\":"sv;
+                batch_ += rec.data;
+                batch_ += ",\"message\":\""sv;
+                batch_ += rec.message;
+                batch_ += "\"}\n"sv;
+            }
+
+            void WriteBatch() {
+                if (batch_.empty()) {
+                    return;
+                }
+                std::cout.write(batch_.data(), batch_.size());
+                console_dirty_ = true;
+                RotateIfNeeded();
+                if (file_.is_open()) {
+                    file_.write(batch_.data(), batch_.size());
+                    file_size_ += batch_.size();
+                    file_dirty_ = true;
+                }
+                batch_.clear();
+            }
+
+            void OpenFile() {
+                file_.close();
+                file_.open(std::string(FILE_PATTERN) + std::to_string(file_index_) + ".log"s, std::ios_base::app | std::ios_base::out);
+                file_size_ = file_.is_open() ? static_cast<std::uint64_t>(file_.tellp()) : 0;
+                const auto now = pt::second_clock::local_time();
+                next_rotation_ = pt::ptime(now.date(), pt::hours(12));
+                if (next_rotation_ <= now) {
+                    next_rotation_ += boost::gregorian::days(1);
+                }
+            }
+
+            void RotateIfNeeded() {
+                if (file_size_ >= ROTATION_SIZE || pt::second_clock::local_time() >= next_rotation_) {
+                    ++file_index_;
+                    OpenFile();
+                }
+            }
+        };
+
+        std::unique_ptr<AsyncLogWriter>& Writer() {
+            static std::unique_ptr<AsyncLogWriter> writer;
+            return writer;
+        }
+
+    } //namespace
+
+    void InitLogging(const LogConfig& config) {
+        Writer() = std::make_unique<AsyncLogWriter>(config);
     }
 
     void Log::Info(std::string_view log_data, std::string_view log_message) {
-        BOOST_LOG_TRIVIAL(info) << logging::add_value(data, log_data) << logging::add_value(msg, log_message);
+        if (auto& writer = Writer()) {
+            writer->Push(log_data, log_message);
+            return;
+        }
+        // Логирование ещё не запущено - пишем синхронно
+        std::cout << "{\"timestamp\":\"" << pt::to_iso_extended_string(pt::microsec_clock::local_time()) << "\","
+                  << "\"data\":" << log_data << ","
+                  << "\"message\":\"" << log_message << "\"}" << std::endl;
     }
 
     void Server::Start(std::string_view address, int port) {
@@ -82,6 +261,9 @@ namespace server_logging {
         case Where::accept:
             svWhere = "accept";
             break;
+        case Where::affinity:
+            svWhere = "affinity";
+            break;
         }
         json::object mapEl;
         mapEl["code"] = ec.value();
@@ -122,4 +304,24 @@ namespace server_logging {
         log_.Info(serialize(mapEl), "response sent"sv);
     }
 
+    void Server::SessionTicks(const SessionTicksRecord& record) {
+        json::object mapEl;
+        mapEl["map"] = to_booststr(record.map_id);
+        mapEl["ticks"] = record.ticks;
+        mapEl["avg_ms"] = record.avg_ms;
+        mapEl["max_ms"] = record.max_ms;
+        json::array histogram;
+        histogram.reserve(record.histogram.size());
+        for (const auto count : record.histogram) {
+            histogram.emplace_back(count);
+        }
+        mapEl["histogram"] = std::move(histogram);
+        mapEl["histogram_base_ms"] = record.histogram_base_ms;
+        mapEl["overruns"] = record.overruns;
+        mapEl["dropped_ticks"] = record.dropped_ticks;
+        mapEl["lag_ms"] = record.lag_ms;
+        mapEl["max_lag_ms"] = record.max_lag_ms;
+        log_.Info(serialize(mapEl), "session ticks"sv);
+    }
+
 } //namespace server_logging
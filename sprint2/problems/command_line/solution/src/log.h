@@ -6,6 +6,9 @@
 #include <boost/system.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <span>
 
 #define LOG() server_logging::Log::GetInstance()
 #define LOGSRV() server_logging::Server::GetInstance()
@@ -19,7 +22,32 @@ namespace server_logging {
     namespace beast = boost::beast;
     namespace http = beast::http;
     
-    void InitBoostLogFilter();
+    // Записи складываются в lock-free очередь, а пишет их в файл и консоль отдельный поток пачками.
+    // Периоды сброса задаются ключами --log-flush-period и --log-console-flush-period
+    struct LogConfig {
+        std::size_t queue_capacity = 1 << 16;
+        std::chrono::milliseconds file_flush_period{1000};
+        std::chrono::milliseconds console_flush_period{50};
+    };
+
+    // Сводка по тикам одной игровой сессии за окно наблюдения
+    struct SessionTicksRecord {
+        std::string_view map_id;
+        uint64_t ticks = 0;
+        double avg_ms = 0;
+        double max_ms = 0;
+        // Корзина 0 - тики короче histogram_base_ms, корзина i - короче histogram_base_ms * 2^i, последняя - остальные
+        std::span<const uint64_t> histogram;
+        double histogram_base_ms = 0;
+        // Пробуждения тикера, на которых выполнено больше одного шага, и шаги, отброшенные ограничением догона
+        uint64_t overruns = 0;
+        uint64_t dropped_ticks = 0;
+        // Опоздание пробуждения тикера: последнее и наибольшее за окно
+        double lag_ms = 0;
+        double max_lag_ms = 0;
+    };
+
+    void InitLogging(const LogConfig& config = {});
 
     class Log {
         Log() = default;
@@ -76,7 +104,8 @@ namespace server_logging {
         enum class Where {
             read,
             write,
-            accept
+            accept,
+            affinity
         };
         static Server& GetInstance() {
             static Server obj;
@@ -88,6 +117,7 @@ namespace server_logging {
         void Request(std::string_view address, std::string_view uri, std::string_view method);
         void Response(int64_t response_time, uint64_t status_code, std::string_view content_type);
         void Msg(std::string_view header, std::string_view message);
+        void SessionTicks(const SessionTicksRecord& record);
     };
 
     template<class SomeRequestHandler>
@@ -98,8 +128,8 @@ namespace server_logging {
         }
 
         template <typename Body, typename Allocator, typename Send>
-        void operator () (tcp::endpoint ep, http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
-            decorated_(ep, std::forward<decltype(req)>(req), std::forward<decltype(send)>(send));
+        void operator () (tcp::endpoint ep, http::request<Body, http::basic_fields<Allocator>>&& req, std::string_view target, Send&& send) {
+            decorated_(ep, std::forward<decltype(req)>(req), target, std::forward<decltype(send)>(send));
         }
 
     private:
@@ -3,8 +3,13 @@
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/signal_set.hpp>
 #include <boost/program_options.hpp>
+#include <cerrno>
 #include <thread>
-
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "json_loader.h"
 #include "request_handler/request_handler.h"
@@ -31,13 +36,63 @@ namespace {
         fn();
     }
 
+    // Ядра, на которых процессу разрешено работать. Под taskset, cgroup cpuset или в контейнере это не обязательно
+    // 0..N-1, а привязка к ядру вне набора не удаётся. Пусто, если набор не удалось получить или платформа не Linux
+    std::vector<unsigned> AllowedCpus() {
+        std::vector<unsigned> cpus;
+#ifdef __linux__
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        if (sched_getaffinity(0, sizeof(cpuset), &cpuset) != 0) {
+            LOGSRV().Error(sys::error_code{errno, sys::system_category()}, server_logging::Server::Where::affinity);
+            return cpus;
+        }
+        for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpuset)) {
+                cpus.push_back(cpu);
+            }
+        }
+#endif
+        return cpus;
+    }
+
+    // Привязывает текущий поток к ядру cpu (только Linux). Если привязка не удалась, поток работает без неё,
+    // а ошибка пишется в лог
+    void PinThisThread([[maybe_unused]] unsigned cpu) {
+#ifdef __linux__
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cpu, &cpuset);
+        if (const int err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset); err != 0) {
+            LOGSRV().Error(sys::error_code{err, sys::system_category()}, server_logging::Server::Where::affinity);
+        }
+#endif
+    }
+
+    // Запускает fn(shard) для каждого шарда в своём потоке, шард 0 выполняется в текущем потоке
+    template <typename Fn>
+    void RunShards(unsigned number_of_shards, const Fn& fn) {
+        number_of_shards = std::max(1u, number_of_shards);
+        std::vector<std::jthread> workers;
+        workers.reserve(number_of_shards - 1);
+        for (unsigned shard = 1; shard < number_of_shards; ++shard) {
+            workers.emplace_back([&fn, shard] {
+                fn(shard);
+            });
+        }
+        fn(0);
+    }
+
     struct Args {
         std::vector<std::string> source;
         std::string config_file;
         std::string www_root;
         std::chrono::milliseconds tick_period;
+        size_t max_catch_up = ticker::Ticker::DEFAULT_MAX_CATCH_UP;
         bool on_tick_api = false;
         bool randomize_spawn_points = false;
+        bool sharded = false;
+        server_logging::LogConfig log_config;
     };
 
     [[nodiscard]] std::optional<Args> ParseCommandLine(int argc, const char* const argv[]) {
@@ -45,17 +100,27 @@ namespace {
         po::options_description desc{"All options"s};
         Args args;
         uint64_t time = 0;
+        uint64_t log_flush_period = 0;
+        uint64_t log_console_flush_period = 0;
         desc.add_options()
             // Добавляем опцию --help и её короткую версию -h
             ("help,h", "produce help message")
             // Задаёт период автоматического обновления игрового состояния в миллисекундах
             ("tick-period,t", po::value(&time)->value_name("milliseconds"s), "set tick period")
+            // Задаёт, сколько пропущенных тиков выполняется подряд после задержки; остальные отбрасываются
+            ("max-catch-up-ticks", po::value(&args.max_catch_up)->value_name("count"s), "set max ticks run back to back after a stall")
             // Задаёт путь к конфигурационному JSON-файлу игры
             ("config-file,c", po::value(&args.config_file)->value_name("file"s), "set config file path")
             // Задаёт путь к каталогу со статическими файлами игры
             ("www-root,w", po::value(&args.www_root)->value_name("dir"s), "set static files root")
             // включает режим, при котором пёс игрока появляется в случайной точке случайно выбранной дороги карты.
-            ("randomize-spawn-points", "spawn dogs at random positions");
+            ("randomize-spawn-points", "spawn dogs at random positions")
+            // включает режим, при котором на каждое ядро запускается свой io_context со своим акцептором
+            ("sharded", "run one pinned io_context with its own SO_REUSEPORT acceptor per core")
+            // Задаёт период сброса буферов лога в файл в миллисекундах
+            ("log-flush-period", po::value(&log_flush_period)->value_name("milliseconds"s), "set log file flush period")
+            // Задаёт период сброса буферов лога в консоль в миллисекундах
+            ("log-console-flush-period", po::value(&log_console_flush_period)->value_name("milliseconds"s), "set log console flush period");
     
         // variables_map хранит значения опций после разбора
         po::variables_map vm;
@@ -83,6 +148,13 @@ namespace {
         if (!vm.contains("randomize-spawn-points"s)) {
             args.randomize_spawn_points = true;
         }
+        args.sharded = vm.contains("sharded"s);
+        if (vm.contains("log-flush-period"s)) {
+            args.log_config.file_flush_period = std::chrono::milliseconds{ log_flush_period };
+        }
+        if (vm.contains("log-console-flush-period"s)) {
+            args.log_config.console_flush_period = std::chrono::milliseconds{ log_console_flush_period };
+        }
         return args;
     }
 
@@ -100,7 +172,7 @@ int main(int argc, const char* argv[]) {
         std::cout << e.what() << std::endl;
         return EXIT_FAILURE;
     }
-    server_logging::InitBoostLogFilter();
+    server_logging::InitLogging(args.log_config);
     try {
         // 1. Загружаем карту из файла и построить модель игры
         model::Game game = json_loader::LoadGame(args.config_file);
@@ -108,30 +180,47 @@ int main(int argc, const char* argv[]) {
         // 1.a Get and check path
         fs::path static_path = args.www_root;
         // 2. Инициализируем io_context
-        const unsigned num_threads = std::thread::hardware_concurrency();
-        net::io_context ioc(num_threads);
+        // В режиме sharded ioc - это шард 0, остальные шарды живут в shards и обслуживаются одним потоком каждый
+        // Потоков и шардов столько, сколько ядер доступно процессу; шард i привязывается к i-му из них
+        const std::vector<unsigned> cpus = AllowedCpus();
+        const unsigned num_threads = cpus.empty() ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<unsigned>(cpus.size());
+        net::io_context ioc(args.sharded ? 1 : num_threads);
+        std::vector<std::unique_ptr<net::io_context>> shards;
+        if (args.sharded) {
+            shards.reserve(num_threads - 1);
+            for (unsigned shard = 1; shard < num_threads; ++shard) {
+                shards.emplace_back(std::make_unique<net::io_context>(1));
+            }
+        }
         // 3. Добавляем асинхронный обработчик сигналов SIGINT и SIGTERM
         net::signal_set signals(ioc, SIGINT, SIGTERM);
-        signals.async_wait([&ioc](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
+        signals.async_wait([&ioc, &shards](const sys::error_code& ec, [[maybe_unused]] int signal_number) {
             if (!ec) {
                 LOGSRV().End(ec);
                 ioc.stop();
+                for (auto& shard : shards) {
+                    shard->stop();
+                }
             }
         });
-        // strand, используемый для доступа к API
+        // strand, используемый для доступа к API, не привязанного к игровой сессии
         auto api_strand = net::make_strand(ioc);
+        // У каждой игровой сессии свой strand и свой тикер. В режиме sharded strand-ы сессий распределяются
+        // по всем шардам, иначе все сессии тикали бы в единственном потоке шарда 0
+        std::vector<net::io_context*> session_contexts{&ioc};
+        for (auto& shard : shards) {
+            session_contexts.push_back(shard.get());
+        }
+        app::SessionStrands session_strands(session_contexts, game);
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры
-        auto handler = std::make_shared<http_handler::RequestHandler>(static_path, api_strand, game, args.on_tick_api);
-        // Настраиваем вызов метода Application::Tick каждые 50 миллисекунд внутри strand
-        auto ticker = std::make_shared<ticker::Ticker>(api_strand, args.tick_period,
-            [&game](std::chrono::milliseconds delta) { game.Tick(delta); }
-        );
+        auto handler = std::make_shared<http_handler::RequestHandler>(static_path, api_strand, game, session_strands, args.on_tick_api);
         // Оборачиваем его в логирующий декоратор
         server_logging::LoggingRequestHandler logging_handler{
-            [handler](auto&& endpoint, auto&& req, auto&& send) {
+            [handler](auto&& endpoint, auto&& req, std::string_view target, auto&& send) {
                 // Обрабатываем запрос
                 (*handler)(std::forward<decltype(endpoint)>(endpoint),
                     std::forward<decltype(req)>(req),
+                    target,
                     std::forward<decltype(send)>(send));
             }
         };
@@ -139,14 +228,38 @@ int main(int argc, const char* argv[]) {
         const auto address = net::ip::make_address(ServerParam::ADDR);
         constexpr net::ip::port_type port = ServerParam::PORT;
         // Запускаем обработку запросов
-        http_server::ServerHttp(ioc, { address, port }, logging_handler);
-        ticker->Start();
+        if (args.sharded) {
+            http_server::ServerHttpSharded(ioc, { address, port }, logging_handler);
+            for (auto& shard : shards) {
+                http_server::ServerHttpSharded(*shard, { address, port }, logging_handler);
+            }
+        }
+        else {
+            http_server::ServerHttp(ioc, { address, port }, logging_handler);
+        }
+        // Настраиваем вызов GameSession::Tick с заданным периодом внутри strand каждой сессии
+        session_strands.StartTickers(args.tick_period, args.max_catch_up);
         // Эта надпись сообщает тестам о том, что сервер запущен и готов обрабатывать запросы
         LOGSRV().Start(address.to_string(), port);
         // 6. Запускаем обработку асинхронных операций
-        RunThreads(num_threads, [&ioc] {
-            ioc.run();
-        });
+        if (args.sharded) {
+            RunShards(num_threads, [&ioc, &shards, &cpus](unsigned shard) {
+                if (!cpus.empty()) {
+                    PinThisThread(cpus[shard]);
+                }
+                if (shard == 0) {
+                    ioc.run();
+                }
+                else {
+                    shards[shard - 1]->run();
+                }
+            });
+        }
+        else {
+            RunThreads(num_threads, [&ioc] {
+                ioc.run();
+            });
+        }
     } catch (const std::exception& ex) {
         std::cerr << ex.what() << std::endl;
         return EXIT_FAILURE;
@@ -1,9 +1,10 @@
 #include "model.h"
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
-#include <boost/random.hpp>
+#include <tuple>
 #include <boost/multiprecision/cpp_bin_float.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
-#include <ctime>
 #include <random>
 
 #define MAX_ROADS_TO_FOUND 1000
@@ -26,7 +27,7 @@ namespace model {
         }
     }
 
-    void Game::AddMap(const Map &map) {
+    void Game::AddMap(Map map) {
         const size_t index = maps_.size();
         if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
             throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
@@ -83,81 +84,163 @@ namespace model {
         else {
             coord = { .x = 0.0, .y = 0.0 };
         }
-        Dog dog = Dog(nick_name, coord);
-        const size_t index = dogs_.size();
-        auto &o = dogs_.emplace_back(std::move(dog));
+        const size_t index = states_->Add(coord);
         try {
-            dogs_id_to_index_.emplace(o.GetId(), index);
+            auto &o = dogs_.emplace_back(nick_name, index, states_.get());
+            try {
+                auto [it, inserted] = dogs_id_to_index_.emplace(o.GetId(), index);
+                try {
+                    // Собака с уже занятой кличкой в индекс не попадает: FindDog возвращает первую
+                    dogs_name_to_index_.emplace(o.GetName(), index);
+                }
+                catch (...) {
+                    dogs_id_to_index_.erase(it);
+                    throw;
+                }
+            }
+            catch (...) {
+                dogs_.pop_back();
+                throw;
+            }
         }
         catch (...) {
-            dogs_.pop_back();
+            states_->PopBack();
             throw;
         }
         return &dogs_.back();
         return nullptr;
     }
 
-    DPoint GameSession::GetRandomRoadCoord() const {
-        std::time_t now = std::time(0);
-        boost::random::mt19937 gen{static_cast<std::uint32_t>(now)};
-        auto random_double = [&](auto x1, auto x2) {
-            if (x2 < x1) {
-                std::swap(x1, x2);
+    DPoint GameSession::GetRandomRoadCoord() {
+        return road_sampler_.Sample(random_);
+    }
+
+    RoadSampler::RoadSampler(const Map::Roads& roads) {
+        const size_t count = roads.size();
+        if (count == 0) {
+            return;
+        }
+        segments_.reserve(count);
+        std::vector<double> weights;
+        weights.reserve(count);
+        double total = 0.0;
+        for (const auto& road : roads) {
+            const DPoint start{static_cast<double>(road.GetStart().x), static_cast<double>(road.GetStart().y)};
+            const DPoint end{static_cast<double>(road.GetEnd().x), static_cast<double>(road.GetEnd().y)};
+            segments_.push_back({start, {end.x - start.x, end.y - start.y}});
+            // Дороги идут вдоль осей, поэтому длина - сумма модулей приращений
+            weights.push_back(std::abs(end.x - start.x) + std::abs(end.y - start.y));
+            total += weights.back();
+        }
+        if (total == 0.0) {
+            std::fill(weights.begin(), weights.end(), 1.0);
+            total = static_cast<double>(count);
+        }
+
+        // Метод Воуза: веса нормируются к среднему 1, каждая "лёгкая" дорога дополняется до 1 долей "тяжёлой"
+        probability_.resize(count);
+        alias_.resize(count);
+        std::vector<size_t> small;
+        std::vector<size_t> large;
+        for (size_t i = 0; i < count; ++i) {
+            weights[i] = weights[i] * static_cast<double>(count) / total;
+            alias_[i] = i;
+            (weights[i] < 1.0 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            const size_t light = small.back();
+            small.pop_back();
+            const size_t heavy = large.back();
+            probability_[light] = weights[light];
+            alias_[light] = heavy;
+            weights[heavy] = (weights[heavy] + weights[light]) - 1.0;
+            if (weights[heavy] < 1.0) {
+                large.pop_back();
+                small.push_back(heavy);
             }
-            std::uniform_real_distribution<double> ur(x1, x2);
-            return ur(gen);
-        };
-        auto &roads = map_->GetRoads();
-        if (roads.size() == 0) {
-            return DPoint();
-        } 
-        boost::random::uniform_int_distribution<size_t> dist{0, roads.size()-1};
-        auto &road = roads[dist(gen)];
-        DPoint coord;
-        if (road.IsHorizontal()) {
-            auto start_point = road.GetStart();
-            auto end_point = road.GetEnd();
-            coord.x = random_double(start_point.x, end_point.x);
-            coord.y = end_point.y;
         }
-        else {
-            auto start_point = road.GetStart();
-            auto end_point = road.GetEnd();
-            coord.y = random_double(start_point.y, end_point.y);
-            coord.x = end_point.x;
+        // Остатки отличаются от 1 только ошибкой округления
+        for (const size_t i : large) {
+            probability_[i] = 1.0;
+        }
+        for (const size_t i : small) {
+            probability_[i] = 1.0;
         }
-        return coord;
     }
 
-    void GameSession::LoadRoadMap() {
-        const auto &roads = map_->GetRoads();
+    RoadIndex::RoadIndex(const Map::Roads& roads) {
+        std::vector<std::pair<Coord, Interval>> horizontal;
+        std::vector<std::pair<Coord, Interval>> vertical;
         for (const auto& road : roads) {
-            auto start = road.GetStart();
-            auto end = road.GetEnd();
+            const auto start = road.GetStart();
+            const auto end = road.GetEnd();
+            // Дорога нулевой длины одновременно горизонтальная и вертикальная и попадает в оба списка
             if (road.IsHorizontal()) {
-                if (start.x > end.x) {
-                    std::swap(start, end);
-                }
-                for (auto x = start.x; x <= end.x; x++) {
-                    road_map.emplace(Point{.x = x, .y = start.y}, &road);
-                }
+                const auto [begin_x, end_x] = std::minmax(start.x, end.x);
+                horizontal.emplace_back(start.y, Interval{begin_x, end_x, end_x, &road});
             }
             if (road.IsVertical()) {
-                if (start.y > end.y) {
-                    std::swap(start, end);
-                }
-                for (auto y = start.y; y <= end.y; y++) {
-                    road_map.emplace(Point{ .x = start.x, .y = y }, &road);
-                }
+                const auto [begin_y, end_y] = std::minmax(start.y, end.y);
+                vertical.emplace_back(start.x, Interval{begin_y, end_y, end_y, &road});
             }
         }
+        rows_.Build(std::move(horizontal));
+        columns_.Build(std::move(vertical));
     }
 
-    Dog* GameSession::FindDog(std::string_view nick_name) {
-        for (auto &dog : dogs_) {
-            if (dog.GetName() == nick_name) {
-                return &dog;
+    void RoadIndex::FindRoads(Point cell, std::vector<const Road*>& out) const {
+        out.clear();
+        rows_.Find(cell.y, cell.x, out);
+        columns_.Find(cell.x, cell.y, out);
+    }
+
+    void RoadIndex::Lines::Build(std::vector<std::pair<Coord, Interval>> segments) {
+        std::sort(segments.begin(), segments.end(), [](const auto& lhs, const auto& rhs) {
+            return std::tie(lhs.first, lhs.second.begin) < std::tie(rhs.first, rhs.second.begin);
+        });
+        lines.clear();
+        intervals.clear();
+        intervals.reserve(segments.size());
+        for (const auto& [coord, interval] : segments) {
+            if (lines.empty() || lines.back().coord != coord) {
+                const auto index = static_cast<uint32_t>(intervals.size());
+                lines.push_back(Line{coord, index, index});
+            }
+            auto& stored = intervals.emplace_back(interval);
+            if (lines.back().last != lines.back().first) {
+                stored.max_end = std::max(stored.end, intervals[intervals.size() - 2].max_end);
             }
+            ++lines.back().last;
+        }
+    }
+
+    void RoadIndex::Lines::Find(Coord line, Coord pos, std::vector<const Road*>& out) const {
+        auto line_it = std::lower_bound(lines.begin(), lines.end(), line, [](const Line& l, Coord coord) {
+            return l.coord < coord;
+        });
+        if (line_it == lines.end() || line_it->coord != line) {
+            return;
+        }
+        const auto first = intervals.begin() + line_it->first;
+        const auto last = intervals.begin() + line_it->last;
+        // Первый отрезок, начинающийся правее pos; подходящие отрезки лежат перед ним
+        auto it = std::upper_bound(first, last, pos, [](Coord p, const Interval& interval) {
+            return p < interval.begin;
+        });
+        while (it != first) {
+            --it;
+            if (it->max_end < pos) {
+                break;
+            }
+            if (it->end >= pos) {
+                out.push_back(it->road);
+            }
+        }
+    }
+
+    Dog* GameSession::FindDog(std::string_view nick_name) {
+        if (auto it = dogs_name_to_index_.find(nick_name); it != dogs_name_to_index_.end()) {
+            return &dogs_[it->second];
         }
         return nullptr;
     }
@@ -180,12 +263,12 @@ namespace model {
         int protect = 0;
         do {
             Point dog_cell = pos_round(start_pos);
-            auto roads = road_map.equal_range(dog_cell);
-            if (PosInRoads(roads, end_pos)) {
+            road_index_.FindRoads(dog_cell, cell_roads_);
+            if (PosInRoads(cell_roads_, end_pos)) {
                 return end_pos;
             }
             prev_pos = start_pos;
-            start_pos = GetExtremePos(roads, end_pos);
+            start_pos = GetExtremePos(cell_roads_, end_pos);
             if (++protect >= MAX_ROADS_TO_FOUND) {
                 throw std::logic_error("Error, not found end cell in roads"s);
             }
@@ -194,23 +277,29 @@ namespace model {
     }
 
     void GameSession::Tick(std::chrono::milliseconds time_delta_ms) {
-        for (auto& dog : dogs_) {
-            if (dog.IsStanding()) {
+        auto& states = *states_;
+        const size_t count = states.Size();
+        end_x_.resize(count);
+        end_y_.resize(count);
+        IntegrateMovement(states, time_delta_ms, end_x_.data(), end_y_.data());
+        for (size_t i = 0; i < count; ++i) {
+            if (!states.moving[i]) {
                 continue;
             }
-            auto start_pos = dog.GetPoint();
-            auto end_pos = dog.GetEndPoint(time_delta_ms);
+            const DPoint start_pos{ states.x[i], states.y[i] };
+            const DPoint end_pos{ end_x_[i], end_y_[i] };
             auto move_pos = MoveDog(start_pos, end_pos);
-            dog.SetPoint(move_pos);
+            states.x[i] = move_pos.x;
+            states.y[i] = move_pos.y;
             if (move_pos != end_pos) {
-                dog.Stop();
-            } 
+                states.SetSpeed(i, DSpeed{});
+            }
         }
     }
 
-    bool GameSession::PosInRoads(RoadMapIter roads, DPoint pos) {
-        for (auto it = roads.first; it != roads.second; ++it) {
-            auto &road = *it->second;
+    bool GameSession::PosInRoads(const std::vector<const Road*>& roads, DPoint pos) {
+        for (const Road* road_ptr : roads) {
+            auto &road = *road_ptr;
             auto [x0, x1, y0, y1] = road.GetRectangle();
             if (pos.x >= x0 && pos.x <= x1 && pos.y >= y0 && pos.y <= y1) {
                 return true;
@@ -218,12 +307,12 @@ namespace model {
         }
         return false;
     }
-    DPoint GameSession::GetExtremePos(RoadMapIter roads, DPoint pos) {
+    DPoint GameSession::GetExtremePos(const std::vector<const Road*>& roads, DPoint pos) {
         typedef std::numeric_limits<DDimension> dbl; 
         DPoint min;
         DDimension min_d = dbl::max(), distance;
-        for (auto it = roads.first; it != roads.second; ++it) {
-            auto& road = *it->second;
+        for (const Road* road_ptr : roads) {
+            auto& road = *road_ptr;
             auto [x0, x1, y0, y1] = road.GetRectangle();
             if (pos.x >= x0 && pos.x <= x1) {
                 if (pos.y <= y0) {
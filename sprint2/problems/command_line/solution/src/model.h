@@ -7,6 +7,7 @@
 #include <atomic>
 #include <map>
 #include <memory>
+#include <random>
 #include "tagged.h"
 #include "log.h"
 #include "dog.h"
@@ -197,28 +198,87 @@ namespace model {
         OfficeIdToIndex warehouse_id_to_index_;
         Offices offices_;
     };
-    struct PointKeyHash {
-        std::size_t operator()(const Point& k) const {
-            return std::hash<Coord>()(k.x) ^ (std::hash<Coord>()(k.y) << 1);
-        }
+    // Индекс дорог по клеткам. Для каждой строки y хранятся горизонтальные отрезки, для каждого столбца x -
+    // вертикальные, отсортированные по началу. Памяти нужно O(число дорог) независимо от их длины,
+    // поиск дорог, проходящих через клетку, - два двоичных поиска без хеширования
+    class RoadIndex {
+    public:
+        explicit RoadIndex(const Map::Roads& roads);
+
+        // Дороги, проходящие через клетку cell. Результат пишется в out, его ёмкость переиспользуется
+        void FindRoads(Point cell, std::vector<const Road*>& out) const;
+
+    private:
+        struct Interval {
+            Coord begin;
+            Coord end;
+            // Наибольший end среди этого и предыдущих отрезков линии: ограничивает просмотр назад
+            Coord max_end;
+            const Road* road;
+        };
+
+        struct Line {
+            Coord coord;
+            uint32_t first;
+            uint32_t last;
+        };
+
+        struct Lines {
+            std::vector<Line> lines;
+            std::vector<Interval> intervals;
+
+            void Build(std::vector<std::pair<Coord, Interval>> segments);
+            void Find(Coord line, Coord pos, std::vector<const Road*>& out) const;
+        };
+
+        Lines rows_;
+        Lines columns_;
     };
-    struct PointKeyEqual {
-        bool operator()(const Point& lhs, const Point& rhs) const {
-            return lhs.x == rhs.x && lhs.y == rhs.y;
+
+    // Случайная точка на осевых линиях дорог карты, равномерно по их суммарной длине. Дорога выбирается за O(1)
+    // по таблице псевдонимов Уолкера с длинами дорог в качестве весов, точка на ней - равномерно.
+    // Если у всех дорог нулевая длина, дороги равновероятны. Генератор передаёт вызывающий
+    class RoadSampler {
+    public:
+        explicit RoadSampler(const Map::Roads& roads);
+
+        template <typename Generator>
+        DPoint Sample(Generator& generator) const {
+            if (segments_.empty()) {
+                return {};
+            }
+            std::uniform_int_distribution<size_t> pick{0, segments_.size() - 1};
+            std::uniform_real_distribution<double> unit{0.0, 1.0};
+            size_t index = pick(generator);
+            if (unit(generator) >= probability_[index]) {
+                index = alias_[index];
+            }
+            const auto& segment = segments_[index];
+            const double t = unit(generator);
+            return {segment.start.x + segment.delta.x * t, segment.start.y + segment.delta.y * t};
         }
-    };
 
-    class GameSession {
     private:
-        using RoadMap = std::unordered_multimap<Point, const Road*, PointKeyHash, PointKeyEqual>;
-        using RoadMapIter = decltype(RoadMap{}.equal_range(Point{}));
+        struct Segment {
+            DPoint start;
+            DPoint delta;
+        };
+        std::vector<Segment> segments_;
+        // Дорога index остаётся выбранной с вероятностью probability_[index], иначе берётся alias_[index]
+        std::vector<double> probability_;
+        std::vector<size_t> alias_;
+    };
 
+    class GameSession {
     public:
         using Dogs = std::deque<Dog>;
         GameSession(const Map* map, bool randomize_spawn_points) 
             : map_(map)
-            , randomize_spawn_points_ (randomize_spawn_points) {
-            LoadRoadMap();
+            , randomize_spawn_points_ (randomize_spawn_points)
+            , road_index_(map->GetRoads())
+            , road_sampler_(map->GetRoads())
+            , random_(std::random_device{}())
+            , states_(std::make_unique<DogStates>()) {
         }
         const Map::Id& MapId() {
             return map_->GetId();
@@ -228,20 +288,35 @@ namespace model {
         const Dogs& GetDogs() const {
             return dogs_;
         }
+        const DogStates& GetDogStates() const noexcept {
+            return *states_;
+        }
         void MoveDog(Dog::Id id, Move move);
         void Tick(std::chrono::milliseconds time_delta_ms);
     private:
         using DogsIdHasher = util::TaggedHasher<Dog::Id>;
         using DogsIdToIndex = std::unordered_map<Dog::Id, size_t, DogsIdHasher>;
+        // Кличка -> индекс первой собаки с такой кличкой
+        using DogsNameToIndex = std::unordered_map<std::string, size_t, util::StringHash, std::equal_to<>>;
         Dogs dogs_;
         DogsIdToIndex dogs_id_to_index_;
+        DogsNameToIndex dogs_name_to_index_;
         const Map* map_;
         const bool randomize_spawn_points_ = true;
-        RoadMap road_map;
-        DPoint GetRandomRoadCoord() const;
-        void LoadRoadMap();
-        static bool PosInRoads(RoadMapIter roads, DPoint pos);
-        DPoint GetExtremePos(RoadMapIter roads, DPoint pos);
+        RoadIndex road_index_;
+        RoadSampler road_sampler_;
+        // Собственный поток случайных чисел сессии для точек появления собак
+        std::mt19937_64 random_;
+        // Дороги текущей клетки в MoveDog, хранится в сессии, чтобы не выделять память на каждом шаге
+        std::vector<const Road*> cell_roads_;
+        // Горячие поля собак. Dog хранят указатель на них, поэтому при перемещении сессии они остаются на месте
+        std::unique_ptr<DogStates> states_;
+        // Конечные точки перемещения собак на текущем тике
+        std::vector<DCoord> end_x_;
+        std::vector<DCoord> end_y_;
+        DPoint GetRandomRoadCoord();
+        static bool PosInRoads(const std::vector<const Road*>& roads, DPoint pos);
+        DPoint GetExtremePos(const std::vector<const Road*>& roads, DPoint pos);
         DPoint MoveDog(DPoint start_pos, DPoint end_pos);
     };
 
@@ -249,7 +324,12 @@ namespace model {
     public:
         using Maps = std::vector<Map>;
 
-        void AddMap(const Map& map);
+        void AddMap(Map map);
+        // Резервирует место под count карт, чтобы загрузка большого конфига не перекладывала их
+        void ReserveMaps(size_t count) {
+            maps_.reserve(count);
+            map_id_to_index_.reserve(count);
+        }
         void SetDefaultDogSpeed(double speed) {
             DefaultDogSpeed = speed;
         }
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+namespace util {
+
+    // Ограниченная lock-free очередь для многих производителей и одного потребителя
+    // (кольцевой буфер Д. Вьюкова). Ёмкость округляется вверх до степени двойки.
+    // Если очередь заполнена, TryPush возвращает false и не ждёт
+    template <typename T>
+    class MpscRing {
+    public:
+        explicit MpscRing(std::size_t capacity) {
+            std::size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            mask_ = size - 1;
+            cells_ = std::make_unique<Cell[]>(size);
+            for (std::size_t i = 0; i < size; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        MpscRing(const MpscRing&) = delete;
+        MpscRing& operator=(const MpscRing&) = delete;
+
+        std::size_t Capacity() const noexcept {
+            return mask_ + 1;
+        }
+
+        // Может вызываться из любого потока
+        bool TryPush(T&& value) {
+            Cell* cell;
+            std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+                const auto diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+            cell->value = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Вызывается только потоком-потребителем
+        bool TryPop(T& value) {
+            Cell& cell = cells_[dequeue_pos_ & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(dequeue_pos_ + 1) < 0) {
+                return false;
+            }
+            value = std::move(cell.value);
+            cell.sequence.store(dequeue_pos_ + mask_ + 1, std::memory_order_release);
+            ++dequeue_pos_;
+            return true;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        std::unique_ptr<Cell[]> cells_;
+        std::size_t mask_ = 0;
+        alignas(64) std::atomic<std::size_t> enqueue_pos_ = 0;
+        alignas(64) std::size_t dequeue_pos_ = 0;
+    };
+
+} //namespace util
@@ -4,6 +4,44 @@ namespace http_handler {
 
     using namespace std::literals;
 
+    namespace {
+
+        // Подписчик рассылки состояния, пишущий в WebSocket. Сессия WebSocket держит себя сама,
+        // поэтому здесь хранится слабая ссылка: закрытое соединение рассылка удалит на следующем тике
+        class WebSocketSubscriber : public app::StateSubscriber {
+        public:
+            explicit WebSocketSubscriber(std::weak_ptr<http_server::WebSocketSession> ws) : ws_(std::move(ws)) {}
+
+            bool IsOpen() const override {
+                auto ws = ws_.lock();
+                return ws && ws->IsOpen();
+            }
+            bool NeedsFullState() const override {
+                if (!full_sent_) {
+                    return true;
+                }
+                auto ws = ws_.lock();
+                return ws && ws->IsResyncRequested();
+            }
+            void Push(std::shared_ptr<const std::string> message, bool full) override {
+                auto ws = ws_.lock();
+                if (!ws) {
+                    return;
+                }
+                if (full) {
+                    full_sent_ = true;
+                    ws->ClearResync();
+                }
+                ws->Send(std::move(message));
+            }
+
+        private:
+            std::weak_ptr<http_server::WebSocketSession> ws_;
+            bool full_sent_ = false;
+        };
+
+    } //namespace
+
     http::status ApiRequestHandler::ErrorCodeToStatus(app::error_code ec) const {
         http::status stat = http::status::ok;
         switch (ec) {
@@ -104,6 +142,21 @@ namespace http_handler {
         }
     }
 
+    void ApiRequestHandler::LinkTickStats() {
+        auto ptr = uri_handler_.AddEndpoint(Endpoint::TICK_STATS);
+        if (ptr) {
+            ptr->SetNeedAuthorization(false)
+                .SetAllowedMethods({ http::verb::get, http::verb::head }, ErrorMessage::GET_IS_EXPECTED, MiscMessage::ALLOWED_GET_HEAD_METHOD)
+                .SetProcessFunction([&](std::string_view) {
+                    return Response::Make(http::status::ok, app_.GetTickStats());
+            });
+        }
+    }
+
+    void ApiRequestHandler::OpenStateStream(const Token& token, std::shared_ptr<http_server::WebSocketSession> ws) const {
+        app_.SubscribeState(token, std::make_shared<WebSocketSubscriber>(std::move(ws)));
+    }
+
     StringResponse ApiRequestHandler::ProcessPostEndpoitWithoutAuthorization(std::string_view body) {
         auto [text, err] = app_.ResponseJoin(body);
         http::status stat;
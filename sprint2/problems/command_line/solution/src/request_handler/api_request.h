@@ -2,6 +2,7 @@
 
 #include <optional>
 #include <mutex>
+#include <variant>
 #include <boost/asio.hpp>
 
 #include "response.h"
@@ -18,7 +19,8 @@ namespace http_handler {
         http::status ErrorCodeToStatus(app::error_code ec) const;
 
     public:
-        ApiRequestHandler(Strand api_strand, model::Game& game, bool on_tick_api) : uri_handler_(), api_strand_(api_strand), app_(game) {
+        ApiRequestHandler(Strand api_strand, model::Game& game, app::SessionStrands& session_strands, bool on_tick_api)
+            : uri_handler_(), api_strand_(api_strand), app_(game, session_strands) {
             LinkJoinWithoutAuthorize();
             LinkPlayersToUriHandler();
             LinkMapsAndMaps();
@@ -27,6 +29,7 @@ namespace http_handler {
             if (on_tick_api) {
                 LinkGameTick();
             }
+            LinkTickStats();
         };
 
         template <typename Body, typename Allocator>
@@ -36,9 +39,123 @@ namespace http_handler {
 
         StringResponse ProcessPostEndpoitWithoutAuthorization(std::string_view body);
 
+        // GET/HEAD /api/v1/maps и /api/v1/maps/{id} отдаются из заранее сериализованных тел без захода в strand.
+        // Для остальных запросов (и неизвестных карт) возвращается std::nullopt и запрос идёт обычным путём
         template <typename Body, typename Allocator>
-        StringResponse ProcessGameRequest(const http::request<Body, http::basic_fields<Allocator>>& req) {
-            return uri_handler_.Process(req);
+        std::optional<SharedResponse> TryHandleMaps(const uri_api::RequestTarget& request_target, const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            if (req.method() != http::verb::get && req.method() != http::verb::head) {
+                return std::nullopt;
+            }
+            if (request_target.GetRoute() != uri_api::Route::Maps) {
+                return std::nullopt;
+            }
+            std::string_view target = request_target.Path();
+            target.remove_prefix(Endpoint::MAPS.size());
+            const app::PreparedBody* prepared = nullptr;
+            if (target.empty()) {
+                prepared = &app_.GetMapBodies().GetMaps();
+            }
+            else if (target.front() == '/') {
+                prepared = app_.GetMapBodies().FindMap(target.substr(1));
+            }
+            if (prepared == nullptr) {
+                return std::nullopt;
+            }
+            auto response = Response::EtagMatches(req.base()[http::field::if_none_match], prepared->etag)
+                ? Response::MakeNotModified(prepared->etag)
+                : Response::MakeShared(prepared->body, prepared->etag, req.method() == http::verb::get);
+            response.keep_alive(req.keep_alive());
+            response.version(req.version());
+            return response;
+        }
+
+        // GET/HEAD /api/v1/game/state и /api/v1/game/players отдаются из опубликованного снимка сессии прямо в потоке
+        // ввода-вывода. Тело сериализуется один раз на поколение снимка, ETag совпадает у всех ответов одного поколения,
+        // поэтому повторный запрос с If-None-Match до следующего изменения получает 304. Ошибки (нет или неизвестен токен)
+        // и запросы, для которых снимок ещё не готов, возвращают std::nullopt и обрабатываются обычным путём в strand сессии
+        template <typename Body, typename Allocator>
+        std::optional<SharedResponse> TryHandleSnapshot(const uri_api::RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            if (req.method() != http::verb::get && req.method() != http::verb::head) {
+                return std::nullopt;
+            }
+            const auto route = target.GetRoute();
+            if (route != uri_api::Route::GameState && route != uri_api::Route::PlayersList) {
+                return std::nullopt;
+            }
+            auto token = security::ExtractTokenFromStringViewAndCheckIt(req.base()[http::field::authorization]);
+            if (!token) {
+                return std::nullopt;
+            }
+            auto prepared = route == uri_api::Route::GameState ? app_.GetStateFromSnapshot(*token) : app_.GetPlayersFromSnapshot(*token);
+            if (!prepared) {
+                return std::nullopt;
+            }
+            auto response = Response::EtagMatches(req.base()[http::field::if_none_match], prepared->etag)
+                ? Response::MakeNotModified(prepared->etag)
+                : Response::MakeShared(std::move(prepared->body), prepared->etag, req.method() == http::verb::get);
+            response.keep_alive(req.keep_alive());
+            response.version(req.version());
+            return response;
+        }
+
+        // Подписка на рассылку состояния сессии по WebSocket (/api/v1/game/state/stream). Токен передаётся
+        // в заголовке Authorization или в параметре ?token=. Для остальных маршрутов возвращается std::nullopt
+        template <typename Body, typename Allocator>
+        std::optional<std::variant<StringResponse, http_server::WebSocketUpgrade>> TryHandleStateStream(const uri_api::RequestTarget& target,
+            const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            if (target.GetRoute() != uri_api::Route::GameStateStream) {
+                return std::nullopt;
+            }
+            auto reject = [&req](StringResponse response) {
+                response.keep_alive(req.keep_alive());
+                response.version(req.version());
+                return response;
+            };
+            if (!http_server::websocket::is_upgrade(req)) {
+                return reject(Response::MakeBadRequestInvalidArgument(ErrorMessage::UPGRADE_IS_EXPECTED));
+            }
+            auto token = security::ExtractTokenFromStringViewAndCheckIt(req.base()[http::field::authorization]);
+            if (!token) {
+                token = security::ExtractTokenFromQuery(target.Query());
+            }
+            if (!token) {
+                return reject(Response::MakeUnauthorizedErrorInvalidToken());
+            }
+            if (app_.CheckToken(*token).second != app::error_code::None) {
+                return reject(Response::MakeUnauthorizedErrorUnknownToken());
+            }
+            return http_server::WebSocketUpgrade{[this, token = *token](std::shared_ptr<http_server::WebSocketSession> ws) {
+                OpenStateStream(token, std::move(ws));
+            }};
+        }
+
+        // Команда движения не трогает состояние сессии: она только кладётся в очередь команд сессии без блокировок
+        // (см. app::CommandQueue), поэтому обрабатывается прямо в потоке ввода-вывода, не занимая strand.
+        // Сводка по тикам читает только атомарные счётчики сессий
+        bool IsStrandFree(const uri_api::RequestTarget& target) const noexcept {
+            const auto route = target.GetRoute();
+            return route == uri_api::Route::GameAction || route == uri_api::Route::TickStats;
+        }
+
+        // Выбирает strand, в котором будет обработан запрос: запросы игрока идут в strand его сессии,
+        // вход в игру - в strand запрошенной карты, остальные запросы - в общий api_strand
+        template <typename Body, typename Allocator>
+        Strand SelectStrand(const uri_api::RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) const {
+            const Strand* strand = nullptr;
+            if (target.GetRoute() == uri_api::Route::JoinGame) {
+                strand = app_.FindJoinStrand(req.body());
+            }
+            else if (target.Path().starts_with(Endpoint::GAME)) {
+                if (auto token = security::ExtractTokenFromStringViewAndCheckIt(req.base()[http::field::authorization])) {
+                    strand = app_.FindSessionStrand(*token);
+                }
+            }
+            return strand ? *strand : api_strand_;
+        }
+
+        template <typename Body, typename Allocator>
+        StringResponse ProcessGameRequest(const uri_api::RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) {
+            return uri_handler_.Process(target, req);
         }
 
         template <typename Body, typename Allocator>
@@ -47,16 +164,16 @@ namespace http_handler {
         }
 
         template <typename Body, typename Allocator>
-        auto HandleGameRequest(const http::request<Body, http::basic_fields<Allocator>>& req) {
-            auto response = ProcessGameRequest(req);
+        auto HandleGameRequest(const uri_api::RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) {
+            auto response = ProcessGameRequest(target, req);
             response.keep_alive(req.keep_alive());
             response.version(req.version());
             return response;
         }
 
         template <typename Body, typename Allocator>
-        StringResponse Handle(const http::request<Body, http::basic_fields<Allocator>>& req) {
-            return std::move(HandleGameRequest(req));
+        StringResponse Handle(const uri_api::RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) {
+            return HandleGameRequest(target, req);
         }
 
         template <typename Fn>
@@ -70,6 +187,8 @@ namespace http_handler {
         }
 
     private:
+        void OpenStateStream(const Token& token, std::shared_ptr<http_server::WebSocketSession> ws) const;
+
         uri_api::UriData uri_handler_;
         Strand api_strand_;
         app::App app_;
@@ -81,6 +200,7 @@ namespace http_handler {
         void LinkGameState();
         void LinkGameActionMove();
         void LinkGameTick();
+        void LinkTickStats();
     };
 
 } //namespace http_handler
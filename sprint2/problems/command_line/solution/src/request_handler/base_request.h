@@ -8,6 +8,10 @@
 #include <iostream>
 #include <variant>
 
+#include "response.h"
+#include "static_index.h"
+#include "../http_server.h"
+
 namespace http_handler {
 
     namespace net = boost::asio;
@@ -18,11 +22,11 @@ namespace http_handler {
     namespace sys = boost::system;
     using namespace std::literals;
 
-    using StringRequest = http::request<http::string_body>;
+    using StringRequest = http_server::Request;
     using StringResponse = http::response<http::string_body>;
     using FileResponse = http::response<http::file_body>;
     using EmptyResponse = http::response<http::empty_body>;
-    using FileRequestResult = std::variant<EmptyResponse, StringResponse, FileResponse>;
+    using FileRequestResult = std::variant<EmptyResponse, StringResponse, FileResponse, SharedResponse>;
 
 
     enum class TypeRequest {
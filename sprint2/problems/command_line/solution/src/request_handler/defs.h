@@ -53,6 +53,7 @@ struct ErrorMessage {
     static inline constexpr std::string_view GET_IS_EXPECTED = "Only GET method is expected"sv;
     static inline constexpr std::string_view INVALID_TOKEN = "Authorization header is missing"sv;
     static inline constexpr std::string_view UNKNOWN_TOKEN = "Player token has not been found"sv;
+    static inline constexpr std::string_view UPGRADE_IS_EXPECTED = "WebSocket upgrade is expected"sv;
 };
 
 struct MiscDefs {
@@ -70,9 +71,11 @@ struct Endpoint {
     static inline constexpr std::string_view MAPS           = "/api/v1/maps"sv;
     static inline constexpr std::string_view GAME           = "/api/v1/game/"sv;
     static inline constexpr std::string_view GAME_TICK      = "/api/v1/game/tick"sv;
+    static inline constexpr std::string_view TICK_STATS     = "/api/v1/game/tick/stats"sv;
     static inline constexpr std::string_view JOIN_GAME      = "/api/v1/game/join"sv;
     static inline constexpr std::string_view PLAYERS_LIST   = "/api/v1/game/players"sv;
     static inline constexpr std::string_view GAME_STATE     = "/api/v1/game/state"sv;
+    static inline constexpr std::string_view GAME_STATE_STREAM = "/api/v1/game/state/stream"sv;
     static inline constexpr std::string_view GAME_ACTION    = "/api/v1/game/player/action"sv;
 };
 
@@ -1,14 +1,11 @@
 #include "file_request.h"
-#include <boost/algorithm/string.hpp>
 #include "../app.h"
-#include "../http_server.h"
 
 namespace http_handler {
 
     TypeRequest FileRequestHandler::ParseTarget(std::string_view target, std::string& res) const {
         std::string_view api = Endpoint::API;
         res = "";
-        std::string uriDecode = http_server::uriDecode(target);
         auto pos = target.find(api);
         if (pos == target.npos) {
             res = target;
@@ -27,44 +24,33 @@ namespace http_handler {
         return path;
     }
 
-    bool FileRequestHandler::CheckFileExist(std::string& file) const {
-        std::string fileName = fs::path(file).filename().string();
-        auto path = fs::path(file).parent_path();
-        for (const auto& entry : fs::directory_iterator{ path }) {
-            std::string fn = entry.path().filename().string();
-            if (boost::iequals(fn, fileName)) {
-                file = entry.path().string();
-                return true;
-            }
-        }
-        return false;
-    }
-    bool FileRequestHandler::FileInRootStaticDir(std::string_view file) const {
-        auto path = fs::weakly_canonical(file).string();
-        if (path.find(static_path_.string()) == 0) {
-            return true;
-        }
-        return false;
-    }
-
     FileRequestResult FileRequestHandler::StaticFilesResponse(
         std::string_view target, bool with_body,
         unsigned http_version, bool keep_alive) const {
         const auto text_response = [&](http::status status, std::string_view text) {
             return MakeStringResponse(status, text, http_version, keep_alive, ContentType::TEXT_PLAIN);
         };
-        if (target == "/") {
-            target = "/index.html";
-        }
-        std::string fullName = static_path_.string() + target.data();
-        if (!FileInRootStaticDir(fullName)) {
-            return text_response(http::status::bad_request, "Bad Request");
-        }
-            
-        if (!CheckFileExist(fullName)) {
+        auto static_file = index_.Find(target);
+        if (!static_file) {
+            // Промах решается без обращений к файловой системе: в индексе есть все файлы каталога
+            if (StaticFileIndex::EscapesRoot(target)) {
+                return text_response(http::status::bad_request, "Bad Request");
+            }
             return text_response(http::status::not_found, "File not found");
         }
-            
+        if (static_file->content) {
+            SharedResponse res;
+            res.version(http_version);
+            res.result(http::status::ok);
+            res.set(http::field::content_type, static_file->content_type);
+            res.content_length(static_file->content->size());
+            res.keep_alive(keep_alive);
+            if (with_body) {
+                res.body() = static_file->content;
+            }
+            return res;
+        }
+        std::string fullName = static_file->path.string();
         http::file_body::value_type file;
         if (sys::error_code ec; file.open(fullName.c_str(), beast::file_mode::read, ec), ec) {
             return text_response(http::status::gone, app::JsonMessage("Gone"sv, "Failed to open file "s + fullName));
@@ -72,8 +58,7 @@ namespace http_handler {
         http::response<http::file_body> res;
         res.version(http_version);
         res.result(http::status::ok);
-        std::string ext = fs::path(fullName).extension().string();
-        res.set(http::field::content_type, ContentType::get(ext).data());
+        res.set(http::field::content_type, static_file->content_type);
 
         if (with_body) {
             res.body() = std::move(file);
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include "response.h"
 #include "defs.h"
+#include "static_index.h"
 
 namespace http_handler {
 
@@ -11,11 +12,16 @@ namespace http_handler {
 	class FileRequestHandler : public BaseRequestHandler {
 
 	public:
-		FileRequestHandler(const fs::path& static_path) : static_path_{ CheckStaticPath(static_path) } {}
+		FileRequestHandler(const fs::path& static_path, net::any_io_executor executor)
+			: static_path_{ CheckStaticPath(static_path) }
+			, index_{ static_path_ } {
+			index_.Watch(executor);
+		}
 		virtual ~FileRequestHandler() {}
 
 	private:
 		const fs::path static_path_;
+		StaticFileIndex index_;
 
 	private: 
 		TypeRequest ParseTarget(std::string_view target, std::string& res) const;
@@ -28,8 +34,6 @@ namespace http_handler {
 		static fs::path CheckStaticPath(const fs::path& path_static);
 		FileRequestResult StaticFilesResponse(std::string_view responseText, bool with_body,
 											  unsigned http_version, bool keep_alive) const;
-		bool CheckFileExist(std::string& file) const;
-		bool FileInRootStaticDir(std::string_view file) const;
 	};
 
 } //namespace http_handler
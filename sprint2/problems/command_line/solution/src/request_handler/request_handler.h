@@ -29,35 +29,58 @@ namespace http_handler {
         using Strand = net::strand<net::io_context::executor_type>;
 
     public:
-        RequestHandler(const fs::path& static_path, Strand api_strand, model::Game& game, bool on_tick_api)
-            : file_handler{ static_path }
+        RequestHandler(const fs::path& static_path, Strand api_strand, model::Game& game, app::SessionStrands& session_strands, bool on_tick_api)
+            : file_handler{ static_path, net::any_io_executor(api_strand.get_inner_executor()) }
             , api_strand_(api_strand)
-            , api_handler_(api_strand, game, on_tick_api) {
+            , api_handler_(api_strand, game, session_strands, on_tick_api) {
         }
 
         RequestHandler(const RequestHandler&) = delete;
         RequestHandler& operator=(const RequestHandler&) = delete;
 
+        // decoded_target - цель запроса, уже раскодированная сессией; действительна, пока ответ не отправлен
         template <typename Body, typename Allocator, typename Send>
-        void operator()(tcp::endpoint, http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+        void operator()(tcp::endpoint, http::request<Body, http::basic_fields<Allocator>>&& req, std::string_view decoded_target, Send&& send) {
             auto version = req.version();
             auto keep_alive = req.keep_alive();
-            std::string target{StringRequest(req).target().data(), StringRequest(req).target().size()};
-            target = http_server::uriDecode(target);
+            const uri_api::RequestTarget target{decoded_target};
             auto api = Endpoint::API;
-            bool is_target = target.size() > api.size() && (target.substr(0, api.size()) == api);
+            bool is_target = target.Full().size() > api.size() && target.Full().starts_with(api);
             try {
                 if (is_target) {
-                    auto handle = [self = shared_from_this(), send,
-                        req = std::forward<decltype(req)>(req), version, keep_alive] {
+                    if (auto response = api_handler_.TryHandleMaps(target, req)) {
+                        return send(std::move(*response));
+                    }
+                    if (auto response = api_handler_.TryHandleSnapshot(target, req)) {
+                        return send(std::move(*response));
+                    }
+                    if (auto result = api_handler_.TryHandleStateStream(target, req)) {
+                        return std::visit([&send](auto&& response) {
+                            send(std::forward<decltype(response)>(response));
+                        }, std::move(*result));
+                    }
+                    const bool strand_free = api_handler_.IsStrandFree(target);
+                    auto strand = strand_free ? api_strand_ : api_handler_.SelectStrand(target, req);
+                    auto handle = [self = shared_from_this(), send, target,
+                        req = std::forward<decltype(req)>(req), version, keep_alive]() mutable {
+                        StringResponse response;
                         try {
-                            return send(std::move(self->api_handler_.Handle(req)));
+                            response = self->api_handler_.Handle(target, req);
                         }
                         catch (...) {
-                            send(self->ReportServerError(version, keep_alive));
+                            response = self->ReportServerError(version, keep_alive);
                         }
+                        // Запрос лежит в арене своего обмена, которая сбрасывается после отправки ответа,
+                        // поэтому он уничтожается до вызова send
+                        {
+                            auto released = std::move(req);
+                        }
+                        send(std::move(response));
                     };
-                    return net::dispatch(api_strand_, handle);
+                    if (strand_free) {
+                        return handle();
+                    }
+                    return net::dispatch(strand, std::move(handle));
                 }
                 return std::visit(
                     [&send](auto&& result) {
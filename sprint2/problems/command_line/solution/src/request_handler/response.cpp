@@ -44,4 +44,48 @@ namespace http_handler {
         return Response::Make(http::status::method_not_allowed, boost::json::serialize(jv), Response::ContentType::TEXT_JSON, allow);
     }
 
-} //namespace http_handler
\ No newline at end of file
+    SharedResponse Response::MakeShared(std::shared_ptr<const std::string> body, std::string_view etag, bool with_body,
+                                        std::string_view content_type) {
+        SharedResponse response;
+        response.result(http::status::ok);
+        response.set(http::field::content_type, content_type);
+        response.set(http::field::cache_control, MiscDefs::NO_CACHE);
+        response.set(http::field::etag, etag);
+        response.content_length(SharedStringBody::size(body));
+        if (with_body) {
+            response.body() = std::move(body);
+        }
+        return response;
+    }
+
+    SharedResponse Response::MakeNotModified(std::string_view etag) {
+        SharedResponse response;
+        response.result(http::status::not_modified);
+        response.set(http::field::cache_control, MiscDefs::NO_CACHE);
+        response.set(http::field::etag, etag);
+        return response;
+    }
+
+    bool Response::EtagMatches(std::string_view if_none_match, std::string_view etag) {
+        // If-None-Match: "*" | список тегов через запятую, сравнение слабое (префикс W/ игнорируется)
+        while (!if_none_match.empty()) {
+            auto comma = if_none_match.find(',');
+            auto tag = if_none_match.substr(0, comma);
+            if_none_match = comma == std::string_view::npos ? std::string_view{} : if_none_match.substr(comma + 1);
+            while (!tag.empty() && tag.front() == ' ') {
+                tag.remove_prefix(1);
+            }
+            while (!tag.empty() && tag.back() == ' ') {
+                tag.remove_suffix(1);
+            }
+            if (tag.starts_with("W/"sv)) {
+                tag.remove_prefix(2);
+            }
+            if (tag == "*"sv || tag == etag) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} //namespace http_handler
@@ -3,7 +3,10 @@
 #include <string_view>
 #include <string>
 #include <variant>
+#include <memory>
 #include <boost/json.hpp>
+#include <boost/optional.hpp>
+#include <boost/asio/buffer.hpp>
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -15,6 +18,43 @@ namespace http_handler {
 
     using StringResponse = http::response<http::string_body>;
 
+    // Тело ответа, ссылающееся на общий неизменяемый буфер: при отправке данные не копируются.
+    // Buffer - любой тип с data() и size()
+    template <typename Buffer>
+    struct SharedBufferBody {
+        using value_type = std::shared_ptr<const Buffer>;
+
+        static std::uint64_t size(const value_type& body) noexcept {
+            return body ? body->size() : 0;
+        }
+
+        class writer {
+        public:
+            using const_buffers_type = boost::asio::const_buffer;
+
+            template <bool isRequest, class Fields>
+            writer(const http::header<isRequest, Fields>&, const value_type& body) : body_(body) {}
+
+            void init(beast::error_code& ec) {
+                ec = {};
+            }
+
+            boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) {
+                ec = {};
+                if (!body_ || body_->size() == 0) {
+                    return boost::none;
+                }
+                return {{ const_buffers_type(body_->data(), body_->size()), false }};
+            }
+
+        private:
+            const value_type& body_;
+        };
+    };
+
+    using SharedStringBody = SharedBufferBody<std::string>;
+    using SharedResponse = http::response<SharedStringBody>;
+
     class Response {
     public:
         Response() = delete;
@@ -33,6 +73,10 @@ namespace http_handler {
         static StringResponse MakeUnauthorizedErrorUnknownToken();
         static StringResponse MakeBadRequestInvalidArgument(std::string_view message);
         static StringResponse MakeMethodNotAllowed(std::string_view message, std::string_view allow);
+        static SharedResponse MakeShared(std::shared_ptr<const std::string> body, std::string_view etag, bool with_body,
+                                         std::string_view content_type = ContentType::TEXT_JSON);
+        static SharedResponse MakeNotModified(std::string_view etag);
+        static bool EtagMatches(std::string_view if_none_match, std::string_view etag);
     };
 
 } //namespace http_handler
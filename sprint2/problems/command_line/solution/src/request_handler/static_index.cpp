@@ -0,0 +1,296 @@
+#include "static_index.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "base_request.h"
+#include "../log.h"
+
+namespace http_handler {
+
+    using namespace std::literals;
+
+    namespace {
+
+        char ToLowerChar(char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        std::string ToLower(std::string_view str) {
+            std::string res(str.size(), '\0');
+            std::transform(str.begin(), str.end(), res.begin(), ToLowerChar);
+            return res;
+        }
+
+        int HexValue(char c) {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            c = ToLowerChar(c);
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            return -1;
+        }
+
+        // Отрезает строку запроса, раскодирует %XX и приводит путь к нижнему регистру
+        std::string MakeKey(std::string_view target) {
+            target = target.substr(0, target.find('?'));
+            if (target == "/"sv) {
+                target = "/index.html"sv;
+            }
+            std::string key;
+            key.reserve(target.size());
+            for (size_t i = 0; i < target.size(); ++i) {
+                if (target[i] == '%' && i + 2 < target.size() && HexValue(target[i + 1]) >= 0 && HexValue(target[i + 2]) >= 0) {
+                    key += ToLowerChar(static_cast<char>(HexValue(target[i + 1]) * 16 + HexValue(target[i + 2])));
+                    i += 2;
+                }
+                else {
+                    key += ToLowerChar(target[i]);
+                }
+            }
+            return key;
+        }
+
+        // Файл могут усечь между file_size и чтением, тогда в копию попадает только прочитанное
+        std::shared_ptr<const std::string> ReadContent(const fs::path& path, std::uint64_t size) {
+            std::ifstream file(path, std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Failed to open file "s + path.string());
+            }
+            std::string content(static_cast<std::size_t>(size), '\0');
+            file.read(content.data(), static_cast<std::streamsize>(content.size()));
+            content.resize(static_cast<std::size_t>(file.gcount()));
+            return std::make_shared<const std::string>(std::move(content));
+        }
+
+    } //namespace
+
+    StaticFileIndex::StaticFileIndex(fs::path root) : root_(std::move(root)) {
+        Rebuild();
+    }
+
+    std::shared_ptr<const StaticFile> StaticFileIndex::Find(std::string_view target) const {
+        auto files = Load();
+        if (auto it = files->find(MakeKey(target)); it != files->end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    bool StaticFileIndex::EscapesRoot(std::string_view target) {
+        const std::string key = MakeKey(target);
+        // После нормализации относительного пути ".." может остаться только в его начале
+        const auto normal = fs::path(key.substr(std::min(key.find_first_not_of('/'), key.size()))).lexically_normal();
+        return !normal.empty() && *normal.begin() == "..";
+    }
+
+    std::shared_ptr<const StaticFileIndex::Files> StaticFileIndex::Load() const {
+        std::lock_guard lock{mutex_};
+        return files_;
+    }
+
+    void StaticFileIndex::Publish(std::shared_ptr<const Files> files) {
+        std::lock_guard lock{mutex_};
+        files_ = std::move(files);
+    }
+
+    std::string StaticFileIndex::KeyOf(const fs::path& path) const {
+        return ToLower("/"s + fs::relative(path, root_).generic_string());
+    }
+
+    std::shared_ptr<const StaticFile> StaticFileIndex::MakeFile(const fs::directory_entry& entry, const Files* previous) const {
+        const auto size = entry.file_size();
+        const auto write_time = entry.last_write_time();
+        if (previous) {
+            if (auto it = previous->find(KeyOf(entry.path())); it != previous->end() && it->second->path == entry.path()
+                && it->second->size == size && it->second->write_time == write_time) {
+                return it->second;
+            }
+        }
+        auto file = std::make_shared<StaticFile>();
+        file->path = entry.path();
+        file->size = size;
+        file->write_time = write_time;
+        file->content_type = ContentType::get(ToLower(entry.path().extension().string()));
+        if (file->size <= MAX_CACHED_SIZE) {
+            try {
+                file->content = ReadContent(file->path, file->size);
+                file->size = file->content->size();
+            }
+            catch (const std::exception&) {
+                file->content = nullptr;
+            }
+        }
+        return file;
+    }
+
+    void StaticFileIndex::Rebuild() {
+        const auto previous = Load();
+        auto files = std::make_shared<Files>();
+        for (const auto& entry : fs::recursive_directory_iterator{ root_, fs::directory_options::skip_permission_denied }) {
+            if (entry.is_regular_file()) {
+                files->insert_or_assign(KeyOf(entry.path()), MakeFile(entry, previous.get()));
+            }
+        }
+        Publish(std::move(files));
+    }
+
+    void StaticFileIndex::Watch([[maybe_unused]] net::any_io_executor executor) {
+#ifdef __linux__
+        int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0) {
+            // Без inotify индекс просто не обновляется
+            return;
+        }
+        inotify_ = std::make_unique<net::posix::stream_descriptor>(executor, fd);
+        AddWatches(root_);
+        updater_ = std::jthread([this](std::stop_token stop) {
+            RunUpdates(stop);
+        });
+        ReadEvents();
+#endif
+    }
+
+#ifdef __linux__
+    void StaticFileIndex::AddWatches(const fs::path& dir) {
+        constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO;
+        const int fd = inotify_->native_handle();
+        // Повторное добавление уже наблюдаемого каталога возвращает тот же дескриптор: после переноса
+        // каталога внутри корня его путь в watches_ обновляется
+        const auto add = [&](const fs::path& path) {
+            if (const int wd = ::inotify_add_watch(fd, path.c_str(), mask); wd >= 0) {
+                const auto relative = fs::relative(path, root_).generic_string();
+                std::lock_guard lock{updates_mutex_};
+                watches_[wd] = relative == "."sv ? ""s : relative;
+            }
+        };
+        add(dir);
+        for (const auto& entry : fs::recursive_directory_iterator{ dir, fs::directory_options::skip_permission_denied }) {
+            if (entry.is_directory()) {
+                add(entry.path());
+            }
+        }
+    }
+
+    void StaticFileIndex::ReadEvents() {
+        inotify_->async_read_some(net::buffer(events_), [this](const sys::error_code& ec, std::size_t bytes_read) {
+            if (ec) {
+                return;
+            }
+            // В потоке ввода-вывода события только разбираются: файловая система читается в updater_
+            {
+                std::lock_guard lock{updates_mutex_};
+                for (std::size_t offset = 0; offset + sizeof(inotify_event) <= bytes_read;) {
+                    inotify_event event;
+                    std::memcpy(&event, events_.data() + offset, sizeof(event));
+                    const char* name = events_.data() + offset + sizeof(event);
+                    offset += sizeof(event) + event.len;
+                    if (event.mask & IN_Q_OVERFLOW) {
+                        // Часть событий потеряна, какие пути изменились - неизвестно
+                        full_rescan_ = true;
+                        continue;
+                    }
+                    auto it = watches_.find(event.wd);
+                    if (it == watches_.end()) {
+                        continue;
+                    }
+                    if (event.mask & IN_IGNORED) {
+                        watches_.erase(it);
+                        continue;
+                    }
+                    if (event.len == 0) {
+                        continue;
+                    }
+                    const std::string_view file_name{name, ::strnlen(name, event.len)};
+                    pending_.insert(it->second.empty() ? std::string(file_name) : it->second + "/"s + std::string(file_name));
+                }
+                ++event_batches_;
+            }
+            updates_cv_.notify_one();
+            ReadEvents();
+        });
+    }
+
+    void StaticFileIndex::RunUpdates(std::stop_token stop) {
+        std::unique_lock lock{updates_mutex_};
+        while (updates_cv_.wait(lock, stop, [this] { return full_rescan_ || !pending_.empty(); })) {
+            // Копирование или распаковка каталога порождает сотни событий подряд: индекс обновляется,
+            // когда они стихнут, а не на каждое из них
+            const auto deadline = std::chrono::steady_clock::now() + MAX_UPDATE_DELAY;
+            for (auto batches = event_batches_; std::chrono::steady_clock::now() < deadline; batches = event_batches_) {
+                if (!updates_cv_.wait_for(lock, stop, UPDATE_DEBOUNCE, [&] { return event_batches_ != batches; })) {
+                    break;
+                }
+            }
+            if (stop.stop_requested()) {
+                return;
+            }
+            const bool full_rescan = std::exchange(full_rescan_, false);
+            const auto changed = std::exchange(pending_, {});
+            lock.unlock();
+            try {
+                if (full_rescan) {
+                    AddWatches(root_);
+                    Rebuild();
+                }
+                else {
+                    Update(changed);
+                }
+            }
+            catch (const std::exception& ex) {
+                LOGSRV().Msg("static index"sv, ex.what());
+            }
+            lock.lock();
+        }
+    }
+
+    void StaticFileIndex::Update(const std::set<std::string>& changed) {
+        const auto previous = Load();
+        auto files = std::make_shared<Files>(*previous);
+        for (const auto& relative : changed) {
+            // Путь могут удалить, пока он перечитывается: тогда за удалением придёт отдельное событие
+            try {
+                UpdatePath(*files, previous.get(), relative);
+            }
+            catch (const fs::filesystem_error&) {
+            }
+        }
+        Publish(std::move(files));
+    }
+
+    void StaticFileIndex::UpdatePath(Files& files, const Files* previous, const std::string& relative) {
+        const fs::path path = root_ / relative;
+        std::error_code ec;
+        const auto status = fs::status(path, ec);
+        if (fs::is_directory(status)) {
+            // Каталог создан или перенесён в корень вместе с содержимым
+            AddWatches(path);
+            for (const auto& entry : fs::recursive_directory_iterator{ path, fs::directory_options::skip_permission_denied }) {
+                if (entry.is_regular_file()) {
+                    files.insert_or_assign(KeyOf(entry.path()), MakeFile(entry, previous));
+                }
+            }
+        }
+        else if (fs::is_regular_file(status)) {
+            files.insert_or_assign(KeyOf(path), MakeFile(fs::directory_entry{path}, previous));
+        }
+        else {
+            // Удалён или перенесён за пределы корня файл либо каталог со всем содержимым
+            const auto key = ToLower("/"s + relative);
+            const auto prefix = key + "/"s;
+            std::erase_if(files, [&](const auto& item) {
+                return item.first == key || item.first.starts_with(prefix);
+            });
+        }
+    }
+#endif
+
+} //namespace http_handler
@@ -0,0 +1,99 @@
+#pragma once
+#include "../sdk.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <boost/asio/any_io_executor.hpp>
+#ifdef __linux__
+#include <boost/asio/posix/stream_descriptor.hpp>
+#endif
+
+namespace http_handler {
+
+    namespace net = boost::asio;
+    namespace fs = std::filesystem;
+
+    struct StaticFile {
+        fs::path path;
+        std::uint64_t size = 0;
+        fs::file_time_type write_time;
+        std::string content_type;
+        // Копия содержимого, снятая при построении индекса. Отправляемый ответ держит копию, поэтому перезапись
+        // или усечение файла на месте не затрагивает его (в отличие от mmap, где это приводит к SIGBUS).
+        // nullptr для файлов больше MAX_CACHED_SIZE, они каждый раз открываются заново и отдаются через http::file_body
+        std::shared_ptr<const std::string> content;
+    };
+
+    // Индекс каталога статических файлов, построенный при старте.
+    // Ключ - путь относительно корня в нижнем регистре, поэтому поиск не зависит от регистра
+    // и не требует обращений к файловой системе. На Linux индекс обновляется по событиям inotify: поток
+    // ввода-вывода только собирает изменившиеся пути, а отдельный поток после затишья в UPDATE_DEBOUNCE
+    // перечитывает только их. Содержимое файлов, у которых не изменились размер и время записи, не перечитывается
+    class StaticFileIndex {
+    public:
+        static constexpr std::uint64_t MAX_CACHED_SIZE = 1024 * 1024;
+        static constexpr std::chrono::milliseconds UPDATE_DEBOUNCE{100};
+        // При непрерывных изменениях индекс всё равно обновляется не реже раза в это время
+        static constexpr std::chrono::milliseconds MAX_UPDATE_DELAY{1000};
+
+        explicit StaticFileIndex(fs::path root);
+        StaticFileIndex(const StaticFileIndex&) = delete;
+        StaticFileIndex& operator=(const StaticFileIndex&) = delete;
+
+        // target - цель запроса как есть (с %XX и, возможно, строкой запроса)
+        std::shared_ptr<const StaticFile> Find(std::string_view target) const;
+        // true, если путь цели после раскодирования выходит за корень каталога (../).
+        // Проверка лексическая, к файловой системе не обращается
+        static bool EscapesRoot(std::string_view target);
+        void Rebuild();
+        // Подписывается на изменения каталога; события читаются в executor
+        void Watch(net::any_io_executor executor);
+
+    private:
+        using Files = std::unordered_map<std::string, std::shared_ptr<const StaticFile>>;
+
+        fs::path root_;
+        mutable std::mutex mutex_;
+        std::shared_ptr<const Files> files_;
+
+        std::shared_ptr<const Files> Load() const;
+        void Publish(std::shared_ptr<const Files> files);
+        std::string KeyOf(const fs::path& path) const;
+        // Запись для файла entry; запись из previous переиспользуется, если файл не изменился
+        std::shared_ptr<const StaticFile> MakeFile(const fs::directory_entry& entry, const Files* previous) const;
+
+#ifdef __linux__
+        std::unique_ptr<net::posix::stream_descriptor> inotify_;
+        std::array<char, 4096> events_;
+        // Всё ниже защищено updates_mutex_. watches_ - каталог (относительно корня) для каждого дескриптора inotify,
+        // pending_ - изменившиеся пути относительно корня
+        std::mutex updates_mutex_;
+        std::condition_variable_any updates_cv_;
+        std::unordered_map<int, std::string> watches_;
+        std::set<std::string> pending_;
+        bool full_rescan_ = false;
+        std::uint64_t event_batches_ = 0;
+        // Объявлен последним: останавливается раньше, чем уничтожаются данные, с которыми он работает
+        std::jthread updater_;
+
+        // Наблюдает за каталогом dir и всеми его подкаталогами
+        void AddWatches(const fs::path& dir);
+        void ReadEvents();
+        void RunUpdates(std::stop_token stop);
+        // Обновляет в индексе только пути changed: перечитывает изменённые файлы, добавляет новые
+        // каталоги целиком и удаляет то, чего больше нет
+        void Update(const std::set<std::string>& changed);
+        void UpdatePath(Files& files, const Files* previous, const std::string& relative);
+#endif
+    };
+
+} //namespace http_handler
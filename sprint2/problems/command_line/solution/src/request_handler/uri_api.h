@@ -1,9 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <optional>
 #include <string_view>
 #include <string>
 #include <functional>
-#include <unordered_map>
 #include <vector>
 
 #include "defs.h"
@@ -19,6 +21,89 @@ namespace uri_api {
     using FunctionWithoutAuthorize = std::function<http_handler::StringResponse(std::string_view body)>;
     using FunctionTargetProcessing = std::function<http_handler::StringResponse(std::string_view target, std::string_view body)>;
 
+    enum class Route {
+        Maps,
+        JoinGame,
+        PlayersList,
+        GameState,
+        GameStateStream,
+        GameAction,
+        GameTick,
+        TickStats,
+        Count
+    };
+
+    struct RouteEntry {
+        std::string_view path;
+        Route route;
+    };
+
+    // Таблица маршрутов API, разбирается на этапе компиляции
+    inline constexpr std::array<RouteEntry, static_cast<size_t>(Route::Count)> ROUTES{{
+        { Endpoint::MAPS,         Route::Maps },
+        { Endpoint::JOIN_GAME,    Route::JoinGame },
+        { Endpoint::PLAYERS_LIST, Route::PlayersList },
+        { Endpoint::GAME_STATE,   Route::GameState },
+        { Endpoint::GAME_STATE_STREAM, Route::GameStateStream },
+        { Endpoint::GAME_ACTION,  Route::GameAction },
+        { Endpoint::GAME_TICK,    Route::GameTick },
+        { Endpoint::TICK_STATS,   Route::TickStats },
+    }};
+
+    // path - раскодированный путь без строки запроса. /api/v1/maps/{id} относится к маршруту Maps
+    constexpr std::optional<Route> FindRoute(std::string_view path) noexcept {
+        for (const auto& entry : ROUTES) {
+            if (entry.path == path) {
+                return entry.route;
+            }
+        }
+        if (path.starts_with(Endpoint::MAPS)) {
+            return Route::Maps;
+        }
+        return std::nullopt;
+    }
+
+    static_assert(FindRoute(Endpoint::GAME_STATE) == Route::GameState);
+    static_assert(FindRoute("/api/v1/maps/map1"sv) == Route::Maps);
+    static_assert(!FindRoute("/api/v1/game/unknown"sv));
+
+    // Разобранная цель запроса: путь, строка запроса и маршрут API. Сама строка не копируется - это
+    // цель, которую сессия раскодировала при чтении запроса, и она живёт, пока ответ не отправлен
+    class RequestTarget {
+    public:
+        RequestTarget() = default;
+        constexpr explicit RequestTarget(std::string_view decoded_target) noexcept
+            : decoded_(decoded_target)
+            , path_size_(std::min(decoded_target.find('?'), decoded_target.size()))
+            , route_(FindRoute(Path())) {
+        }
+
+        constexpr std::string_view Full() const noexcept {
+            return decoded_;
+        }
+        constexpr std::string_view Path() const noexcept {
+            return decoded_.substr(0, path_size_);
+        }
+        // Пусто, если строки запроса нет
+        constexpr std::string_view Query() const noexcept {
+            return path_size_ < decoded_.size() ? decoded_.substr(path_size_ + 1) : std::string_view{};
+        }
+        constexpr bool HasQuery() const noexcept {
+            return path_size_ < decoded_.size();
+        }
+        constexpr std::optional<Route> GetRoute() const noexcept {
+            return route_;
+        }
+
+    private:
+        std::string_view decoded_;
+        size_t path_size_ = 0;
+        std::optional<Route> route_;
+    };
+
+    static_assert(RequestTarget("/api/v1/game/state?x=1"sv).GetRoute() == Route::GameState);
+    static_assert(RequestTarget("/api/v1/game/state?x=1"sv).Query() == "x=1"sv);
+
     class UriElement {
 
         struct AllowedMethods {
@@ -89,7 +174,7 @@ namespace uri_api {
         }
 
         template <typename Body, typename Allocator>
-        http_handler::StringResponse ProcessRequest(const http::request<Body, http::basic_fields<Allocator>>& req) {
+        http_handler::StringResponse ProcessRequest(const RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) {
 
             if (methods_.data_.empty() || std::find(methods_.data_.begin(), methods_.data_.end(), req.method()) != methods_.data_.end()) {
 
@@ -103,14 +188,11 @@ namespace uri_api {
                     });
                 }
 
-                std::string target = http_server::uriDecode(req.target());
                 if (target_processing_.need_) {
-                    return process_function_target_processing_(target, req.body());
+                    return process_function_target_processing_(target.Path(), req.body());
                 }
-                    
-                auto stop = target.find('?');
-                if ( stop != std::string::npos) {
-                    return process_function_without_authorize_(target.substr(stop + 1));
+                if (target.HasQuery()) {
+                    return process_function_without_authorize_(target.Query());
                 }
                 return process_function_without_authorize_(req.body());
             }            
@@ -130,25 +212,28 @@ namespace uri_api {
     public:
         UriData() = default;
         UriElement* AddEndpoint(std::string_view uri) {
-            auto [it, ret] = data_.try_emplace(std::string(uri));
-            return &it->second;
+            auto route = FindRoute(uri);
+            if (!route) {
+                return nullptr;
+            }
+            const auto index = static_cast<size_t>(*route);
+            linked_[index] = true;
+            return &data_[index];
         }
         template <typename Body, typename Allocator>
-        http_handler::StringResponse Process(const http::request<Body, http::basic_fields<Allocator>>& req) {
-            std::string target = http_server::uriDecode(req.target());
-            auto stop = target.find('?');
-            target = std::string(target.substr(0, stop));
-            if (target.starts_with(Endpoint::MAPS)) {
-                target = std::string{ Endpoint::MAPS };
-            }
-            auto it = data_.find(target);
-            if (it != data_.end()) {
-                return it->second.ProcessRequest(req);
+        http_handler::StringResponse Process(const RequestTarget& target, const http::request<Body, http::basic_fields<Allocator>>& req) {
+            if (auto route = target.GetRoute()) {
+                const auto index = static_cast<size_t>(*route);
+                if (linked_[index]) {
+                    return data_[index].ProcessRequest(target, req);
+                }
             }
             return http_handler::Response::MakeJSON(http::status::bad_request, ErrorCode::BAD_REQUEST, ErrorMessage::INVALID_ENDPOINT);
         }
     private:
-        std::unordered_map<std::string, UriElement> data_;
+        static constexpr size_t ROUTE_COUNT = static_cast<size_t>(Route::Count);
+        std::array<UriElement, ROUTE_COUNT> data_;
+        std::array<bool, ROUTE_COUNT> linked_{};
     };
 
 } //namespace uri_api
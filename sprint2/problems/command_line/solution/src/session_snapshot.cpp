@@ -0,0 +1,178 @@
+#include "session_snapshot.h"
+#include <algorithm>
+#include <random>
+#include "hex.h"
+#include "json_writer.h"
+#include "state_feed.h"
+
+namespace app {
+
+    using namespace std::literals;
+
+    namespace {
+
+        size_t ChunkCount(size_t size) {
+            return (size + SessionSnapshot::CHUNK_SIZE - 1) / SessionSnapshot::CHUNK_SIZE;
+        }
+
+        // Общий счётчик поколений всех сессий. Случайная добавка в ETag не даёт клиенту, закэшировавшему ответ
+        // до перезапуска сервера, получить 304 на состояние с тем же номером поколения
+        std::atomic<uint64_t> next_generation = 1;
+        const uint64_t etag_nonce = [] {
+            std::random_device random_device;
+            return (static_cast<uint64_t>(random_device()) << 32) | random_device();
+        }();
+
+        PreparedBody MakePreparedBody(std::string body, uint64_t generation) {
+            PreparedBody prepared;
+            prepared.etag.assign(2 * util::HEX64_SIZE + 2, '"');
+            util::WriteHex64(etag_nonce, prepared.etag.data() + 1);
+            util::WriteHex64(generation, prepared.etag.data() + 1 + util::HEX64_SIZE);
+            prepared.body = std::make_shared<const std::string>(std::move(body));
+            return prepared;
+        }
+
+    } //namespace
+
+    std::string SerializeState(const SessionSnapshot& snapshot) {
+        std::string body;
+        body.reserve(32 + snapshot.size * DOG_STATE_SIZE_HINT);
+        util::JsonWriter writer{body};
+        writer.BeginObject().Key("players"sv).BeginObject();
+        for (const auto& chunk : snapshot.states) {
+            for (const auto& dog : *chunk) {
+                writer.Key(dog.id);
+                WriteDogState(writer, dog.pos, dog.speed, dog.dir);
+            }
+        }
+        writer.EndObject().EndObject();
+        return body;
+    }
+
+    std::string SerializePlayers(const SessionSnapshot& snapshot) {
+        std::string body;
+        body.reserve(2 + snapshot.size * 48);
+        util::JsonWriter writer{body};
+        writer.BeginObject();
+        for (const auto& chunk : snapshot.names) {
+            for (const auto& dog : *chunk) {
+                writer.Key(dog.id).BeginObject().Key("name"sv).String(dog.name).EndObject();
+            }
+        }
+        writer.EndObject();
+        return body;
+    }
+
+    const PreparedBody& SessionSnapshot::StateBody() const {
+        return state_body->Get([this] {
+            return MakePreparedBody(SerializeState(*this), state_generation);
+        });
+    }
+
+    const PreparedBody& SessionSnapshot::PlayersBody() const {
+        return players_body->Get([this] {
+            return MakePreparedBody(SerializePlayers(*this), players_generation);
+        });
+    }
+
+    SnapshotPublisher::SnapshotPublisher(const model::GameSession& session)
+        : session_(session) {
+        Publish(SessionSnapshot{}, true);
+        PublishAll();
+    }
+
+    template <typename T, typename Fn>
+    bool SnapshotPublisher::RebuildChunk(SessionSnapshot::Chunks<T>& chunks, size_t chunk, Fn&& make) const {
+        const size_t begin = chunk * SessionSnapshot::CHUNK_SIZE;
+        const size_t end = std::min(begin + SessionSnapshot::CHUNK_SIZE, session_.GetDogs().size());
+        auto items = std::make_shared<std::vector<T>>();
+        items->reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            items->push_back(make(i));
+        }
+        if (chunk == chunks.size()) {
+            chunks.push_back(std::move(items));
+            return true;
+        }
+        if (*chunks[chunk] == *items) {
+            return false;
+        }
+        chunks[chunk] = std::move(items);
+        return true;
+    }
+
+    SessionSnapshot::DogState SnapshotPublisher::MakeState(size_t index) const {
+        const auto& dog = session_.GetDogs()[index];
+        return {*dog.GetId(), dog.GetPoint(), dog.GetSpeed(), dog.GetDir()};
+    }
+
+    void SnapshotPublisher::AppendNewDogs(SessionSnapshot& next) const {
+        const auto& dogs = session_.GetDogs();
+        if (dogs.size() == next.size) {
+            return;
+        }
+        // Последний неполный блок пересобирается целиком, прежний остаётся у старых снимков
+        for (size_t chunk = next.size / SessionSnapshot::CHUNK_SIZE; chunk < ChunkCount(dogs.size()); ++chunk) {
+            RebuildChunk(next.names, chunk, [&dogs](size_t i) {
+                return SessionSnapshot::DogName{*dogs[i].GetId(), std::string(dogs[i].GetName())};
+            });
+            RebuildChunk(next.states, chunk, [this](size_t i) {
+                return MakeState(i);
+            });
+        }
+        next.size = dogs.size();
+    }
+
+    void SnapshotPublisher::PublishAll() {
+        SessionSnapshot next = *last_;
+        const size_t old_size = next.size;
+        AppendNewDogs(next);
+        const bool joined = old_size != next.size;
+        // Блоки, в которые попали новые собаки, AppendNewDogs уже пересобрал
+        const size_t stale_chunks = joined ? old_size / SessionSnapshot::CHUNK_SIZE : next.states.size();
+        bool changed = joined;
+        for (size_t chunk = 0; chunk < stale_chunks; ++chunk) {
+            changed |= RebuildChunk(next.states, chunk, [this](size_t i) {
+                return MakeState(i);
+            });
+        }
+        if (changed) {
+            Publish(std::move(next), joined);
+        }
+    }
+
+    void SnapshotPublisher::PublishDog(size_t index) {
+        SessionSnapshot next = *last_;
+        const size_t old_size = next.size;
+        AppendNewDogs(next);
+        const bool joined = old_size != next.size;
+        bool changed = joined;
+        if (index < old_size) {
+            changed |= RebuildChunk(next.states, index / SessionSnapshot::CHUNK_SIZE, [this](size_t i) {
+                return MakeState(i);
+            });
+        }
+        if (changed) {
+            Publish(std::move(next), joined);
+        }
+    }
+
+    void SnapshotPublisher::Publish(SessionSnapshot&& next, bool players_changed) {
+        next.state_generation = next_generation.fetch_add(1, std::memory_order_relaxed);
+        next.state_body = std::make_shared<const LazyBody>();
+        if (players_changed) {
+            next.players_generation = next_generation.fetch_add(1, std::memory_order_relaxed);
+            next.players_body = std::make_shared<const LazyBody>();
+        }
+        last_ = std::make_shared<const SessionSnapshot>(std::move(next));
+        current_.store(last_, std::memory_order_release);
+    }
+
+    std::shared_ptr<const SessionSnapshot> SnapshotPublisher::Load() const {
+        if (pending_writes_.load(std::memory_order_acquire) != 0) {
+            return nullptr;
+        }
+        return current_.load(std::memory_order_acquire);
+    }
+
+} //namespace app
@@ -0,0 +1,119 @@
+#pragma once
+#include "sdk.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "model.h"
+
+namespace app {
+
+    // Заранее сериализованное тело ответа и его строгий ETag
+    struct PreparedBody {
+        std::shared_ptr<const std::string> body;
+        std::string etag;
+    };
+
+    // Тело ответа, которое сериализуется при первом обращении и дальше общее для всех читателей
+    class LazyBody {
+    public:
+        template <typename Fn>
+        const PreparedBody& Get(Fn&& make) const {
+            std::call_once(once_, [&] {
+                prepared_ = make();
+            });
+            return prepared_;
+        }
+
+    private:
+        mutable std::once_flag once_;
+        mutable PreparedBody prepared_;
+    };
+
+    // Опубликованное неизменяемое состояние игровой сессии. Собаки разложены по блокам по CHUNK_SIZE штук:
+    // следующий снимок разделяет с предыдущим все блоки, которые не изменились
+    struct SessionSnapshot {
+        static constexpr size_t CHUNK_SIZE = 256;
+
+        struct DogState {
+            uint64_t id;
+            model::DPoint pos;
+            model::DSpeed speed;
+            model::Direction dir;
+            bool operator==(const DogState&) const = default;
+        };
+        struct DogName {
+            uint64_t id;
+            std::string name;
+            bool operator==(const DogName&) const = default;
+        };
+        template <typename T>
+        using Chunks = std::vector<std::shared_ptr<const std::vector<T>>>;
+
+        // Клички меняются только при входе новых игроков, поэтому хранятся отдельно от координат
+        Chunks<DogState> states;
+        Chunks<DogName> names;
+        size_t size = 0;
+
+        // Поколения меняются только вместе с содержимым и уникальны среди всех сессий процесса
+        uint64_t state_generation = 0;
+        uint64_t players_generation = 0;
+        // Кэш тел ответов. Кэш списка игроков переходит в следующий снимок, пока не войдёт новый игрок
+        std::shared_ptr<const LazyBody> state_body;
+        std::shared_ptr<const LazyBody> players_body;
+
+        // Тела /api/v1/game/state и /api/v1/game/players с ETag по поколению
+        const PreparedBody& StateBody() const;
+        const PreparedBody& PlayersBody() const;
+    };
+
+    // Тело ответа /api/v1/game/state, совпадает с App::GetState
+    std::string SerializeState(const SessionSnapshot& snapshot);
+    // Тело ответа /api/v1/game/players, совпадает с App::GetPlayers
+    std::string SerializePlayers(const SessionSnapshot& snapshot);
+
+    // Публикация снимков сессии в стиле RCU: strand сессии после каждого изменения собирает новый снимок
+    // и атомарно подменяет указатель, читатели из любых потоков берут текущий снимок без блокировки strand.
+    // Если после тика или команды ни одна собака не изменилась, новый снимок (и новое поколение) не публикуется.
+    // Publish* вызываются только в strand сессии, остальные методы - из любого потока
+    class SnapshotPublisher {
+    public:
+        explicit SnapshotPublisher(const model::GameSession& session);
+        SnapshotPublisher(const SnapshotPublisher&) = delete;
+        SnapshotPublisher& operator=(const SnapshotPublisher&) = delete;
+
+        // После тика: координаты всех собак
+        void PublishAll();
+        // После входа игрока или команды движения: одна собака и все новые собаки
+        void PublishDog(size_t index);
+
+        // Изменение (тик или команды) поставлено в очередь strand, но ещё не опубликовано. Пока такие изменения есть,
+        // Load возвращает nullptr, и читатель идёт через strand, чтобы не увидеть состояние до изменения,
+        // о котором клиенту уже ответили
+        void BeginWrite() noexcept {
+            pending_writes_.fetch_add(1, std::memory_order_acq_rel);
+        }
+        void EndWrite(uint32_t count = 1) noexcept {
+            pending_writes_.fetch_sub(count, std::memory_order_acq_rel);
+        }
+
+        std::shared_ptr<const SessionSnapshot> Load() const;
+
+    private:
+        // false, если блок не изменился (тогда остаётся прежний)
+        template <typename T, typename Fn>
+        bool RebuildChunk(SessionSnapshot::Chunks<T>& chunks, size_t chunk, Fn&& make) const;
+        void AppendNewDogs(SessionSnapshot& next) const;
+        SessionSnapshot::DogState MakeState(size_t index) const;
+        void Publish(SessionSnapshot&& next, bool players_changed);
+
+        const model::GameSession& session_;
+        // Последний опубликованный снимок. Меняется только в strand сессии, поэтому strand может читать его напрямую
+        std::shared_ptr<const SessionSnapshot> last_;
+        std::atomic<std::shared_ptr<const SessionSnapshot>> current_;
+        std::atomic<uint32_t> pending_writes_ = 0;
+    };
+
+} //namespace app
@@ -0,0 +1,82 @@
+#include "state_feed.h"
+#include <algorithm>
+#include <numeric>
+
+namespace app {
+
+    using namespace std::literals;
+
+    void WriteDogState(util::JsonWriter& writer, model::DPoint pos, model::DSpeed speed, model::Direction dir) {
+        writer.BeginObject();
+        writer.Key("pos"sv).BeginArray().Number(pos.x).Number(pos.y).EndArray();
+        writer.Key("speed"sv).BeginArray().Number(speed.x).Number(speed.y).EndArray();
+        writer.Key("dir"sv).String(model::DirectionName(dir));
+        writer.EndObject();
+    }
+
+    void StateFeed::Subscribe(std::shared_ptr<StateSubscriber> subscriber) {
+        subscribers_.emplace_back(std::move(subscriber));
+    }
+
+    void StateFeed::Publish() {
+        std::erase_if(subscribers_, [](const auto& subscriber) {
+            return !subscriber->IsOpen();
+        });
+        if (subscribers_.empty()) {
+            // Без подписчиков дельту считать не от чего: следующий подписчик всё равно получит полное состояние
+            last_.clear();
+            return;
+        }
+        const auto& dogs = session_.GetDogs();
+        changed_.clear();
+        last_.resize(dogs.size());
+        for (size_t i = 0; i < dogs.size(); ++i) {
+            DogSnapshot snapshot{dogs[i].GetPoint(), dogs[i].GetSpeed(), dogs[i].GetDir(), true};
+            if (snapshot != last_[i]) {
+                changed_.push_back(i);
+                last_[i] = snapshot;
+            }
+        }
+        std::shared_ptr<const std::string> full;
+        std::shared_ptr<const std::string> delta;
+        for (const auto& subscriber : subscribers_) {
+            if (subscriber->NeedsFullState()) {
+                if (!full) {
+                    full = MakeFullMessage();
+                }
+                subscriber->Push(full, true);
+            }
+            else if (!changed_.empty()) {
+                if (!delta) {
+                    delta = MakeMessage("delta"sv, changed_);
+                }
+                subscriber->Push(delta, false);
+            }
+        }
+    }
+
+    std::shared_ptr<const std::string> StateFeed::MakeMessage(std::string_view type, const std::vector<size_t>& indices) const {
+        const auto& dogs = session_.GetDogs();
+        std::string msg;
+        msg.reserve(64 + indices.size() * DOG_STATE_SIZE_HINT);
+        util::JsonWriter writer{msg};
+        writer.BeginObject();
+        writer.Key("type"sv).String(type);
+        writer.Key("players"sv).BeginObject();
+        for (size_t i : indices) {
+            const auto& dog = dogs[i];
+            writer.Key(*dog.GetId());
+            WriteDogState(writer, dog.GetPoint(), dog.GetSpeed(), dog.GetDir());
+        }
+        writer.EndObject();
+        writer.EndObject();
+        return std::make_shared<const std::string>(std::move(msg));
+    }
+
+    std::shared_ptr<const std::string> StateFeed::MakeFullMessage() const {
+        std::vector<size_t> all(session_.GetDogs().size());
+        std::iota(all.begin(), all.end(), size_t{0});
+        return MakeMessage("full"sv, all);
+    }
+
+} //namespace app
@@ -0,0 +1,61 @@
+#pragma once
+#include "sdk.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include "json_writer.h"
+#include "model.h"
+
+namespace app {
+
+    // Состояние одной собаки в формате ответа /api/v1/game/state: {"pos":[x,y],"speed":[x,y],"dir":"U"}
+    void WriteDogState(util::JsonWriter& writer, model::DPoint pos, model::DSpeed speed, model::Direction dir);
+    // Примерный размер записи одной собаки, чтобы заранее зарезервировать буфер
+    inline constexpr size_t DOG_STATE_SIZE_HINT = 96;
+
+    // Получатель рассылки состояния игровой сессии
+    class StateSubscriber {
+    public:
+        virtual ~StateSubscriber() = default;
+        // false - подписчик закрыт, рассылка его удаляет
+        virtual bool IsOpen() const = 0;
+        // true, пока подписчик не получил полное состояние: сразу после подписки и после потери сообщений
+        virtual bool NeedsFullState() const = 0;
+        virtual void Push(std::shared_ptr<const std::string> message, bool full) = 0;
+    };
+
+    // Рассылка состояния сессии подписчикам после каждого тика. Сообщение сериализуется один раз
+    // и разделяется всеми подписчиками: новым подписчикам уходит полное состояние, остальным - только
+    // собаки, изменившиеся с прошлого тика. Все методы вызываются в strand сессии
+    class StateFeed {
+    public:
+        explicit StateFeed(const model::GameSession& session) : session_(session) {}
+        StateFeed(const StateFeed&) = delete;
+        StateFeed& operator=(const StateFeed&) = delete;
+
+        void Subscribe(std::shared_ptr<StateSubscriber> subscriber);
+        void Publish();
+
+    private:
+        struct DogSnapshot {
+            model::DPoint pos;
+            model::DSpeed speed;
+            model::Direction dir = model::Direction::NORTH;
+            // false, пока собака не попала ни в одно сообщение
+            bool sent = false;
+
+            bool operator==(const DogSnapshot&) const = default;
+        };
+
+        std::shared_ptr<const std::string> MakeMessage(std::string_view type, const std::vector<size_t>& indices) const;
+        std::shared_ptr<const std::string> MakeFullMessage() const;
+
+        const model::GameSession& session_;
+        std::vector<std::shared_ptr<StateSubscriber>> subscribers_;
+        // Последнее разосланное состояние. Собаки только добавляются, поэтому индекс совпадает с индексом в GetDogs()
+        std::vector<DogSnapshot> last_;
+        // Индексы собак, изменившихся за тик; хранится между тиками, чтобы не выделять память заново
+        std::vector<size_t> changed_;
+    };
+
+} //namespace app
@@ -1,4 +1,5 @@
 #pragma once
+#include <string_view>
 #include <compare>
 
 namespace util {
@@ -36,4 +37,13 @@ namespace util {
         }
     };
 
+    // Хешер строк для неупорядоченных контейнеров с гетерогенным поиском (вместе с std::equal_to<>):
+    // find по std::string_view не создаёт временную std::string
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
 } //namespace util
@@ -1,6 +1,13 @@
 #pragma once
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
+#include <algorithm>
+#include <cassert>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
 
 namespace ticker {
 
@@ -8,15 +15,34 @@ namespace ticker {
     namespace sys = boost::system;
     using namespace std::chrono;
 
+    // Тикер с фиксированным шагом. Тики назначаются на абсолютные моменты start + k * period, поэтому время работы
+    // обработчика не сдвигает расписание, а обработчик всегда получает ровно period.
+    // Если пробуждение опоздало больше чем на период, пропущенные шаги выполняются подряд, но не больше max_catch_up
+    // за одно пробуждение. Остальные отбрасываются, и расписание переходит на ближайший дедлайн в будущем
     class Ticker : public std::enable_shared_from_this<Ticker> {
     public:
         using Strand = net::strand<net::io_context::executor_type>;
         using Handler = std::function<void(milliseconds delta)>;
 
-        Ticker(Strand strand, milliseconds period, Handler handler)
+        static constexpr size_t DEFAULT_MAX_CATCH_UP = 5;
+
+        // Пишутся в strand тикера, читаются из любого потока
+        struct Stats {
+            std::atomic<uint64_t> steps = 0;
+            // Пробуждения, на которых пришлось выполнить больше одного шага: прошлые тики не уложились в период
+            std::atomic<uint64_t> overruns = 0;
+            // Шаги, отброшенные из-за ограничения max_catch_up
+            std::atomic<uint64_t> dropped_steps = 0;
+            // Опоздание пробуждения относительно дедлайна: последнее и наибольшее с момента сброса читателем
+            std::atomic<int64_t> last_lag_us = 0;
+            std::atomic<int64_t> max_lag_us = 0;
+        };
+
+        Ticker(Strand strand, milliseconds period, Handler handler, size_t max_catch_up = DEFAULT_MAX_CATCH_UP)
             : strand_{ strand }
             , period_{ period }
-            , handler_{ std::move(handler) } {
+            , handler_{ std::move(handler) }
+            , max_catch_up_{ std::max<size_t>(max_catch_up, 1) } {
         }
 
         void Start() {
@@ -24,23 +50,33 @@ namespace ticker {
                 return;
             }
             net::dispatch(strand_, [self = shared_from_this()] {
-                self->last_tick_ = Clock::now();
+                self->next_deadline_ = Clock::now() + self->period_;
                 self->ScheduleTick();
                 }
             );
         }
 
+        const Stats& GetStats() const noexcept {
+            return stats_;
+        }
+        // Читатель может сбрасывать max_lag_us, чтобы получать максимум за своё окно наблюдения
+        Stats& GetStats() noexcept {
+            return stats_;
+        }
+
     private:
         using Clock = steady_clock;
         Strand strand_;
         milliseconds period_;
         net::steady_timer timer_{strand_};
         Handler handler_;
-        steady_clock::time_point last_tick_;
+        size_t max_catch_up_;
+        Clock::time_point next_deadline_;
+        Stats stats_;
     
         void ScheduleTick() {
             assert(strand_.running_in_this_thread());
-            timer_.expires_after(period_);
+            timer_.expires_at(next_deadline_);
             timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
                 self->OnTick(ec);
                 }
@@ -48,20 +84,35 @@ namespace ticker {
         }
 
         void OnTick(sys::error_code ec) {
-            using namespace std::chrono;
             assert(strand_.running_in_this_thread());
-
-            if (!ec) {
-                auto this_tick = Clock::now();
-                auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-                last_tick_ = this_tick;
+            if (ec) {
+                return;
+            }
+            const auto lag = std::max(Clock::now() - next_deadline_, Clock::duration::zero());
+            const int64_t lag_us = duration_cast<microseconds>(lag).count();
+            stats_.last_lag_us.store(lag_us, std::memory_order_relaxed);
+            if (lag_us > stats_.max_lag_us.load(std::memory_order_relaxed)) {
+                stats_.max_lag_us.store(lag_us, std::memory_order_relaxed);
+            }
+            // Сколько дедлайнов уже наступило, включая текущий
+            const auto due = static_cast<size_t>(lag / period_) + 1;
+            const size_t steps = std::min(due, max_catch_up_);
+            if (due > 1) {
+                stats_.overruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (due > steps) {
+                stats_.dropped_steps.fetch_add(due - steps, std::memory_order_relaxed);
+            }
+            for (size_t i = 0; i < steps; ++i) {
                 try {
-                    handler_(delta);
+                    handler_(period_);
                 }
                 catch (...) {
                 }
-                ScheduleTick();
             }
+            stats_.steps.fetch_add(steps, std::memory_order_relaxed);
+            next_deadline_ += period_ * static_cast<int64_t>(due);
+            ScheduleTick();
         }
     };
 
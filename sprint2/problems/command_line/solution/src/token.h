@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <optional>
 
+#include "hex.h"
 #include "tagged.h"
 #include "request_handler/response.h"
 
@@ -12,20 +14,47 @@ namespace detail {
 
     struct TokenTag {};
 
+    // 128 случайных бит токена. В запросах и ответах токен записывается 32 шестнадцатеричными цифрами
+    struct TokenBits {
+        uint64_t hi = 0;
+        uint64_t lo = 0;
+        auto operator<=>(const TokenBits&) const = default;
+    };
+
 } //namespace detail
 
-using Token = util::Tagged<std::string, detail::TokenTag>;
+using Token = util::Tagged<detail::TokenBits, detail::TokenTag>;
 
 namespace security {
 
+    inline constexpr size_t TOKEN_SIZE = 2 * util::HEX64_SIZE;
+
+    static inline std::optional<Token> ParseToken(std::string_view text) {
+        if (text.size() != TOKEN_SIZE) {
+            return std::nullopt;
+        }
+        auto hi = util::ParseHex64(text.substr(0, util::HEX64_SIZE));
+        auto lo = util::ParseHex64(text.substr(util::HEX64_SIZE));
+        if (!hi || !lo) {
+            return std::nullopt;
+        }
+        return Token{detail::TokenBits{*hi, *lo}};
+    }
+
+    static inline std::string TokenToString(const Token& token) {
+        std::string text(TOKEN_SIZE, '0');
+        util::WriteHex64((*token).hi, text.data());
+        util::WriteHex64((*token).lo, text.data() + util::HEX64_SIZE);
+        return text;
+    }
+
     static inline std::string_view GetToken(std::string_view autorization_text) {
         std::string_view bearer = "Bearer "sv;
-        std::string_view ex_token = "6516861d89ebfff147bf2eb2b5153ae1"sv;
         std::string_view nullstr = autorization_text.substr(0, 0);
         if (autorization_text.substr(0, bearer.size()) != bearer) {
             return nullstr;
         }
-        if (autorization_text.size() < (bearer.size() + ex_token.size())) {
+        if (autorization_text.size() < (bearer.size() + TOKEN_SIZE)) {
             return nullstr;
         }
         size_t begin = bearer.size();
@@ -35,7 +64,7 @@ namespace security {
             }
         ) - autorization_text.begin();
         std::string_view out = autorization_text.substr(begin, end - begin);
-        if (out.size() != ex_token.size()) {
+        if (out.size() != TOKEN_SIZE) {
             return nullstr;
         }
         return out;
@@ -45,11 +74,20 @@ namespace security {
         if (body.empty()) {
             return std::nullopt;
         }
-        std::string token{GetToken(body)};
-        if (token.empty()) {
-            return std::nullopt;
-        } 
-        return {Token(token)};
+        return ParseToken(GetToken(body));
+    }
+
+    // Токен из параметра token= строки запроса. Нужен для WebSocket: браузер не позволяет задать заголовок Authorization
+    static inline std::optional<Token> ExtractTokenFromQuery(std::string_view query) {
+        std::string_view param = "token="sv;
+        while (!query.empty()) {
+            std::string_view pair = query.substr(0, query.find('&'));
+            if (pair.substr(0, param.size()) == param) {
+                return ParseToken(pair.substr(param.size()));
+            }
+            query.remove_prefix(std::min(query.size(), pair.size() + 1));
+        }
+        return std::nullopt;
     }
 
     template <typename Fn, typename Body, typename Allocator>
@@ -0,0 +1,111 @@
+#include "websocket_session.h"
+#include "log.h"
+
+#include <sstream>
+
+namespace http_server {
+
+    namespace {
+
+        constexpr http::field HANDSHAKE_FIELDS[] = {
+            http::field::host,
+            http::field::connection,
+            http::field::upgrade,
+            http::field::sec_websocket_key,
+            http::field::sec_websocket_version,
+        };
+
+    } //namespace
+
+    void WebSocketSession::Run(const UpgradeRequest& request, std::string buffered, std::function<void(std::shared_ptr<WebSocketSession>)> on_open) {
+        // Таймауты HTTP-сессии к WebSocket не подходят: за простоем соединения следит сам websocket::stream
+        beast::get_lowest_layer(ws_).expires_never();
+        ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
+        // Принять рукопожатие вместе с уже прочитанными байтами websocket::stream умеет только из сырых данных,
+        // поэтому запрос сериализуется обратно, а байты после него остаются в буфере потока и читаются как первые
+        // кадры. Буфер потока невелик (tcp_frame_size), так что из запроса берутся только поля рукопожатия.
+        // async_accept копирует данные до возврата
+        UpgradeRequest handshake_request{request.method(), request.target(), request.version()};
+        for (const auto field : HANDSHAKE_FIELDS) {
+            if (auto it = request.find(field); it != request.end()) {
+                handshake_request.set(field, it->value());
+            }
+        }
+        std::ostringstream handshake;
+        handshake << handshake_request << buffered;
+        const std::string data = handshake.str();
+        ws_.async_accept(net::buffer(data), [self = shared_from_this(), on_open = std::move(on_open)](beast::error_code ec) mutable {
+            self->OnAccept(std::move(on_open), ec);
+        });
+    }
+
+    void WebSocketSession::Send(Message message) {
+        net::dispatch(ws_.get_executor(), [self = shared_from_this(), message = std::move(message)]() mutable {
+            self->Enqueue(std::move(message));
+        });
+    }
+
+    void WebSocketSession::OnAccept(std::function<void(std::shared_ptr<WebSocketSession>)> on_open, beast::error_code ec) {
+        if (ec) {
+            LOGSRV().Error(ec, server_logging::Server::Where::accept);
+            return;
+        }
+        ws_.text(true);
+        open_.store(true, std::memory_order_release);
+        if (on_open) {
+            on_open(shared_from_this());
+        }
+        Read();
+    }
+
+    void WebSocketSession::Read() {
+        ws_.async_read(read_buffer_, beast::bind_front_handler(&WebSocketSession::OnRead, shared_from_this()));
+    }
+
+    void WebSocketSession::OnRead(beast::error_code ec, [[maybe_unused]] std::size_t bytes_read) {
+        if (ec) {
+            open_.store(false, std::memory_order_release);
+            if (ec != websocket::error::closed && ec != net::error::eof) {
+                LOGSRV().Error(ec, server_logging::Server::Where::read);
+            }
+            return;
+        }
+        read_buffer_.consume(read_buffer_.size());
+        Read();
+    }
+
+    void WebSocketSession::Enqueue(Message message) {
+        if (!IsOpen()) {
+            return;
+        }
+        // Первое сообщение очереди может уже писаться в сокет, его трогать нельзя
+        if (queue_.size() >= MAX_QUEUE_SIZE) {
+            queue_.erase(queue_.begin() + (writing_ ? 1 : 0), queue_.end());
+            resync_.store(true, std::memory_order_release);
+        }
+        queue_.push_back(std::move(message));
+        if (!writing_) {
+            Write();
+        }
+    }
+
+    void WebSocketSession::Write() {
+        writing_ = true;
+        ws_.async_write(net::buffer(*queue_.front()), beast::bind_front_handler(&WebSocketSession::OnWrite, shared_from_this()));
+    }
+
+    void WebSocketSession::OnWrite(beast::error_code ec, [[maybe_unused]] std::size_t bytes_written) {
+        writing_ = false;
+        if (ec) {
+            open_.store(false, std::memory_order_release);
+            queue_.clear();
+            LOGSRV().Error(ec, server_logging::Server::Where::write);
+            return;
+        }
+        queue_.pop_front();
+        if (!queue_.empty()) {
+            Write();
+        }
+    }
+
+} //namespace http_server
@@ -0,0 +1,74 @@
+#pragma once
+#include "sdk.h"
+
+#include <boost/asio/dispatch.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace http_server {
+
+    namespace net = boost::asio;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace websocket = beast::websocket;
+    namespace sys = boost::system;
+
+    class WebSocketSession;
+
+    // Ответ обработчика на запрос Upgrade: websocket. Когда очередь конвейера доходит до этого запроса,
+    // соединение передаётся WebSocketSession, и после рукопожатия вызывается on_open
+    struct WebSocketUpgrade {
+        std::function<void(std::shared_ptr<WebSocketSession>)> on_open;
+    };
+
+    // Соединение WebSocket, по которому сервер только отправляет текстовые сообщения.
+    // Входящие сообщения читаются (чтобы обрабатывались ping и close) и отбрасываются
+    class WebSocketSession : public std::enable_shared_from_this<WebSocketSession> {
+    public:
+        using Message = std::shared_ptr<const std::string>;
+        using UpgradeRequest = http::request<http::empty_body>;
+        // Не отправленные сообщения сверх этого числа выбрасываются, см. IsResyncRequested
+        static constexpr std::size_t MAX_QUEUE_SIZE = 64;
+
+        explicit WebSocketSession(beast::tcp_stream&& stream) : ws_(std::move(stream)) {}
+
+        // buffered - байты, прочитанные HTTP-сессией вслед за запросом на Upgrade (первые кадры клиента)
+        void Run(const UpgradeRequest& request, std::string buffered, std::function<void(std::shared_ptr<WebSocketSession>)> on_open);
+
+        // Может вызываться из любого потока, сообщения отправляются в порядке вызовов
+        void Send(Message message);
+
+        bool IsOpen() const noexcept {
+            return open_.load(std::memory_order_acquire);
+        }
+        // true, если медленный клиент не успевал читать и часть сообщений была выброшена
+        bool IsResyncRequested() const noexcept {
+            return resync_.load(std::memory_order_acquire);
+        }
+        void ClearResync() noexcept {
+            resync_.store(false, std::memory_order_release);
+        }
+
+    private:
+        websocket::stream<beast::tcp_stream> ws_;
+        beast::flat_buffer read_buffer_;
+        std::deque<Message> queue_;
+        bool writing_ = false;
+        std::atomic<bool> open_ = false;
+        std::atomic<bool> resync_ = false;
+
+        void OnAccept(std::function<void(std::shared_ptr<WebSocketSession>)> on_open, beast::error_code ec);
+        void Read();
+        void OnRead(beast::error_code ec, std::size_t bytes_read);
+        void Enqueue(Message message);
+        void Write();
+        void OnWrite(beast::error_code ec, std::size_t bytes_written);
+    };
+
+} //namespace http_server
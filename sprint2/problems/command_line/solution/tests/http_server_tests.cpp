@@ -0,0 +1,161 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/read.hpp>
+#include <boost/asio/read_until.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "../src/http_server.h"
+
+namespace {
+
+    namespace net = boost::asio;
+    namespace http = boost::beast::http;
+    using tcp = net::ip::tcp;
+    using namespace std::literals;
+
+    // Сокет клиента теста: его записи не считаются
+    std::atomic<int> client_fd = -1;
+    std::atomic<std::size_t> server_sends = 0;
+
+    // Отвечает синхронно. Запрос не перемещается, поэтому живёт у сессии до возврата из обработчика
+    struct TestHandler {
+        template <typename Request, typename Send>
+        void operator()(tcp::endpoint, Request&& req, std::string_view target, Send&& send) {
+            if (target == "/ws"sv) {
+                return send(http_server::WebSocketUpgrade{});
+            }
+            http::response<http::string_body> res{http::status::ok, req.version()};
+            res.set(http::field::content_type, "text/plain"sv);
+            res.body() = std::string(target);
+            res.keep_alive(req.keep_alive());
+            res.prepare_payload();
+            send(std::move(res));
+        }
+    };
+
+    // Сервер на свободном порту loopback, работающий в отдельном потоке
+    class TestServer {
+    public:
+        TestServer() {
+            tcp::acceptor probe{ioc_, {net::ip::make_address("127.0.0.1"), 0}};
+            endpoint_ = probe.local_endpoint();
+            probe.close();
+            http_server::ServerHttp(ioc_, endpoint_, TestHandler{});
+            thread_ = std::thread([this] { ioc_.run(); });
+        }
+
+        ~TestServer() {
+            ioc_.stop();
+            thread_.join();
+        }
+
+        tcp::socket Connect() {
+            tcp::socket socket{client_ioc_};
+            socket.connect(endpoint_);
+            // Зависший тест падает по таймауту чтения, а не висит
+            timeval timeout{5, 0};
+            setsockopt(socket.native_handle(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            return socket;
+        }
+
+    private:
+        net::io_context ioc_;
+        net::io_context client_ioc_;
+        tcp::endpoint endpoint_;
+        std::thread thread_;
+    };
+
+    std::size_t CountOccurrences(std::string_view text, std::string_view pattern) {
+        std::size_t count = 0;
+        for (auto pos = text.find(pattern); pos != std::string_view::npos; pos = text.find(pattern, pos + 1)) {
+            ++count;
+        }
+        return count;
+    }
+
+} //namespace
+
+// Считает системные вызовы записи сервера: asio отправляет данные сокета через sendmsg
+extern "C" ssize_t sendmsg(int fd, const msghdr* msg, int flags) {
+    using SendMsg = ssize_t (*)(int, const msghdr*, int);
+    static const auto real_sendmsg = reinterpret_cast<SendMsg>(dlsym(RTLD_NEXT, "sendmsg"));
+    if (fd != client_fd.load()) {
+        ++server_sends;
+    }
+    return real_sendmsg(fd, msg, flags);
+}
+
+TEST_CASE("Pipelined requests received together are answered with one write") {
+    constexpr std::size_t depth = 8;
+    TestServer server;
+    auto socket = server.Connect();
+    std::string requests;
+    for (std::size_t i = 0; i < depth; ++i) {
+        requests += "GET /item/"s + std::to_string(i) + " HTTP/1.1\r\nHost: test\r\n\r\n"s;
+    }
+    client_fd = socket.native_handle();
+    server_sends = 0;
+    net::write(socket, net::buffer(requests));
+
+    net::streambuf received;
+    net::read_until(socket, received, "/item/"s + std::to_string(depth - 1));
+    const std::string text{net::buffers_begin(received.data()), net::buffers_end(received.data())};
+    CHECK(CountOccurrences(text, "HTTP/1.1 200 OK\r\n"sv) == depth);
+    // Ответы на всю пачку уходят одной записью
+    CHECK(server_sends == 1);
+}
+
+TEST_CASE("Partially received request does not hold back the previous response") {
+    TestServer server;
+    auto socket = server.Connect();
+    // Начало тела второго запроса содержит пустую строку, как будто за ним уже идёт целый запрос
+    net::write(socket, net::buffer("GET /first HTTP/1.1\r\nHost: test\r\n\r\n"
+                                   "POST /second HTTP/1.1\r\nHost: test\r\nContent-Length: 8\r\n\r\na\r\n\r\n"s));
+    net::streambuf received;
+    net::read_until(socket, received, "/first"s);
+
+    net::write(socket, net::buffer("bcd"s));
+    net::read_until(socket, received, "/second"s);
+    const std::string text{net::buffers_begin(received.data()), net::buffers_end(received.data())};
+    CHECK(CountOccurrences(text, "HTTP/1.1 200 OK\r\n"sv) == 2);
+}
+
+TEST_CASE("WebSocket upgrade keeps frames sent together with the handshake") {
+    TestServer server;
+    auto socket = server.Connect();
+    const std::string handshake =
+        "GET /ws HTTP/1.1\r\n"
+        "Host: test\r\n"
+        "Connection: Upgrade\r\n"
+        "Upgrade: websocket\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "\r\n"s;
+    // Маскированный ping без данных: FIN + opcode 0x9, бит маски, нулевой ключ маски
+    const std::string ping{"\x89\x80\x00\x00\x00\x00", 6};
+    net::write(socket, net::buffer(handshake + ping));
+
+    net::streambuf received;
+    const std::size_t header_size = net::read_until(socket, received, "\r\n\r\n"s);
+    const std::string header{net::buffers_begin(received.data()), net::buffers_begin(received.data()) + header_size};
+    REQUIRE(header.starts_with("HTTP/1.1 101"sv));
+    received.consume(header_size);
+
+    // Сервер отвечает pong без маски и без данных
+    if (received.size() < 2) {
+        net::read(socket, received, net::transfer_at_least(2 - received.size()));
+    }
+    const auto* frame = static_cast<const unsigned char*>(received.data().data());
+    CHECK(frame[0] == 0x8A);
+    CHECK(frame[1] == 0x00);
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/asio/io_context.hpp>
+
+#include <numeric>
+#include <string>
+
+#include "../src/app.h"
+
+namespace {
+
+    using namespace std::literals;
+
+    model::Map MakeMap(std::string id) {
+        model::Map map{model::Map::Id{id}, id, 1.0};
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 10, map.GetRoadOffset()});
+        return map;
+    }
+
+} //namespace
+
+TEST_CASE("Per-session tick stats are collected for every session") {
+    model::Game game;
+    game.AddMap(MakeMap("map1"s));
+    game.AddMap(MakeMap("map2"s));
+    boost::asio::io_context ioc;
+    app::SessionStrands strands{ioc, game};
+
+    constexpr uint64_t tick_count = 3;
+    for (uint64_t i = 0; i < tick_count; ++i) {
+        strands.TickAll(100ms);
+    }
+    ioc.run();
+
+    const auto reports = strands.GetTickStats();
+    REQUIRE(reports.size() == 2);
+    for (const auto& report : reports) {
+        CHECK((*report.map_id == "map1"s || *report.map_id == "map2"s));
+        CHECK(report.ticks == tick_count);
+        CHECK(std::accumulate(report.histogram.begin(), report.histogram.end(), uint64_t{0}) == tick_count);
+        CHECK(report.max <= report.total);
+        // Без тикера показатели ритма остаются нулевыми
+        CHECK(report.overruns == 0);
+        CHECK(report.dropped_ticks == 0);
+    }
+    CHECK(reports[0].map_id != reports[1].map_id);
+}
+
+TEST_CASE("Tick stats body lists sessions with the slowest tick first") {
+    app::SessionTickReport fast{model::Map::Id{"fast"s}, 4, 400us, 150us, 100us};
+    fast.histogram[1] = 4;
+    app::SessionTickReport slow{model::Map::Id{"slow"s}, 2, 5000us, 4000us, 1000us};
+    slow.histogram[5] = 2;
+
+    const std::string body = app::TickStatsToJson({fast, slow});
+    const auto slow_pos = body.find("\"mapId\":\"slow\""sv);
+    const auto fast_pos = body.find("\"mapId\":\"fast\""sv);
+    REQUIRE(slow_pos != std::string::npos);
+    REQUIRE(fast_pos != std::string::npos);
+    CHECK(slow_pos < fast_pos);
+    CHECK(body.find("\"ticks\":2,\"avgMs\":2.5,\"maxMs\":4,"sv) != std::string::npos);
+    CHECK(body.find("\"histogram\":[0,4,0,0,0,0,0,0,0,0,0,0]"sv) != std::string::npos);
+    CHECK(body.starts_with("{\"histogramBaseMs\":0.1,\"sessions\":["sv));
+}
@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+#include "../src/collision_detector.h"
+
+namespace {
+
+using namespace collision_detector;
+
+class VectorProvider : public ItemGathererProvider {
+public:
+    VectorProvider(std::vector<Item> items, std::vector<Gatherer> gatherers)
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
+    }
+
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+    Item GetItem(size_t idx) const override {
+        return items_[idx];
+    }
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+    Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_[idx];
+    }
+
+    ItemGathererSpans Spans() const noexcept {
+        return {items_, gatherers_};
+    }
+
+private:
+    std::vector<Item> items_;
+    std::vector<Gatherer> gatherers_;
+};
+
+// Карта 1000 × 1000, собаки за тик проходят до 5 единиц вдоль осей. Плотность задаётся числом предметов и собак
+VectorProvider MakeProvider(size_t items_count, size_t gatherers_count) {
+    constexpr double SIDE = 1000.0;
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<double> coord{0.0, SIDE};
+    std::uniform_real_distribution<double> step{-5.0, 5.0};
+    std::vector<Item> items;
+    items.reserve(items_count);
+    for (size_t i = 0; i < items_count; ++i) {
+        items.push_back({{coord(gen), coord(gen)}, 0.0});
+    }
+    std::vector<Gatherer> gatherers;
+    gatherers.reserve(gatherers_count);
+    for (size_t g = 0; g < gatherers_count; ++g) {
+        geom::Point2D start{coord(gen), coord(gen)};
+        geom::Point2D end = start;
+        (g % 2 ? end.x : end.y) += step(gen);
+        gatherers.push_back({start, end, 0.6});
+    }
+    return VectorProvider{std::move(items), std::move(gatherers)};
+}
+
+template <typename Find>
+void RunFindGatherEvents(benchmark::State& state, Find&& find) {
+    const auto provider = MakeProvider(static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        auto events = find(provider);
+        benchmark::DoNotOptimize(events.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+
+void BM_FindGatherEventsBruteForce(benchmark::State& state) {
+    RunFindGatherEvents(state, FindGatherEventsBruteForce);
+}
+
+// Через виртуальный интерфейс ItemGathererProvider
+void BM_FindGatherEvents(benchmark::State& state) {
+    RunFindGatherEvents(state, [](const ItemGathererProvider& provider) {
+        return FindGatherEvents(provider);
+    });
+}
+
+// Через массивы поставщика
+void BM_FindGatherEventsBulk(benchmark::State& state) {
+    RunFindGatherEvents(state, [](const VectorProvider& provider) {
+        return FindGatherEvents(provider.Spans());
+    });
+}
+
+// Большая сессия: 10k предметов и 10k собак, аргумент - число потоков (1 - последовательно)
+void BM_FindGatherEventsThreads(benchmark::State& state) {
+    const auto provider = MakeProvider(10'000, 10'000);
+    const auto spans = provider.Spans();
+    const auto threads = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        auto events = FindGatherEvents(spans.items, spans.gatherers, threads);
+        benchmark::DoNotOptimize(events.data());
+    }
+}
+
+// Пакетная проверка предметов одной собакой: предметы в квадрате 20 × 20 вокруг её отрезка
+template <typename Collect>
+void RunTryCollectPoints(benchmark::State& state, Collect&& collect) {
+    const auto count = static_cast<size_t>(state.range(0));
+    std::mt19937 gen{42};
+    std::uniform_real_distribution<double> coord{-10.0, 10.0};
+    std::vector<double> xs(count), ys(count), widths(count, 0.3);
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = coord(gen);
+        ys[i] = coord(gen);
+    }
+    const Gatherer gatherer{{-3, 0}, {3, 0}, 0.6};
+    std::vector<double> proj_ratio(count), sq_distance(count);
+    std::vector<uint8_t> hits(count);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(collect(gatherer, xs.data(), ys.data(), widths.data(), count, proj_ratio.data(),
+                                         sq_distance.data(), hits.data()));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_TryCollectPointsScalar(benchmark::State& state) {
+    RunTryCollectPoints(state, TryCollectPointsScalar);
+}
+
+void BM_TryCollectPoints(benchmark::State& state) {
+    RunTryCollectPoints(state, TryCollectPoints);
+}
+
+// Аргументы: число предметов и число собак
+void Densities(benchmark::internal::Benchmark* b) {
+    for (const int64_t items : {100, 1'000, 10'000}) {
+        for (const int64_t gatherers : {10, 100, 1'000}) {
+            b->Args({items, gatherers});
+        }
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_FindGatherEventsBruteForce)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEvents)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEventsBulk)->Apply(Densities)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FindGatherEventsThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Unit(benchmark::kMicrosecond)->UseRealTime();
+BENCHMARK(BM_TryCollectPointsScalar)->Arg(64)->Arg(1'024)->Arg(16'384);
+BENCHMARK(BM_TryCollectPoints)->Arg(64)->Arg(1'024)->Arg(16'384);
+
+BENCHMARK_MAIN();
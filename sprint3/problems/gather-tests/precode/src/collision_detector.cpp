@@ -1,32 +1,447 @@
-#include "collision_detector.h"
-#include <cassert>
-
-namespace collision_detector {
-
-CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
-    // Проверим, что перемещение ненулевое.
-    // Тут приходится использовать строгое равенство, а не приближённое,
-    // пскольку при сборе заказов придётся учитывать перемещение даже на небольшое
-    // расстояние.
-    assert(b.x != a.x || b.y != a.y);
-    const double u_x = c.x - a.x;
-    const double u_y = c.y - a.y;
-    const double v_x = b.x - a.x;
-    const double v_y = b.y - a.y;
-    const double u_dot_v = u_x * v_x + u_y * v_y;
-    const double u_len2 = u_x * u_x + u_y * u_y;
-    const double v_len2 = v_x * v_x + v_y * v_y;
-    const double proj_ratio = u_dot_v / v_len2;
-    const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / v_len2;
-
-    return CollectionResult(sq_distance, proj_ratio);
-}
-
-// В задании на разработку тестов реализовывать следующую функцию не нужно -
-// она будет линковаться извне.
-/*
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
-}
-*/
-
+#include "collision_detector.h"
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLLISION_X86_KERNELS
+#include <immintrin.h>
+#endif
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cassert>
+#include <cmath>
+#include <exception>
+#include <latch>
+#include <queue>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace collision_detector {
+
+CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c) {
+    // Проверим, что перемещение ненулевое.
+    // Тут приходится использовать строгое равенство, а не приближённое,
+    // пскольку при сборе заказов придётся учитывать перемещение даже на небольшое
+    // расстояние.
+    assert(b.x != a.x || b.y != a.y);
+    const double u_x = c.x - a.x;
+    const double u_y = c.y - a.y;
+    const double v_x = b.x - a.x;
+    const double v_y = b.y - a.y;
+    const double u_dot_v = u_x * v_x + u_y * v_y;
+    const double u_len2 = u_x * u_x + u_y * u_y;
+    const double v_len2 = v_x * v_x + v_y * v_y;
+    const double proj_ratio = u_dot_v / v_len2;
+    const double sq_distance = u_len2 - (u_dot_v * u_dot_v) / v_len2;
+
+    return CollectionResult(sq_distance, proj_ratio);
+}
+
+namespace {
+
+size_t CollectScalar(const Gatherer& gatherer, const double* item_x, const double* item_y, const double* item_width,
+                     size_t begin, size_t count, double* proj_ratio, double* sq_distance, uint8_t* hits) {
+    size_t collected = 0;
+    for (size_t i = begin; i < count; ++i) {
+        const auto result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {item_x[i], item_y[i]});
+        proj_ratio[i] = result.proj_ratio;
+        sq_distance[i] = result.sq_distance;
+        hits[i] = result.IsCollected(gatherer.width + item_width[i]);
+        collected += hits[i];
+    }
+    return collected;
+}
+
+#ifdef COLLISION_X86_KERNELS
+// Обрабатывает кратную четырём часть массива и возвращает число обработанных предметов.
+// Операции те же и в том же порядке, что в TryCollectPoint, без FMA, поэтому результат совпадает со скалярным
+__attribute__((target("avx2")))
+size_t CollectAvx2(const Gatherer& gatherer, const double* item_x, const double* item_y, const double* item_width,
+                   size_t count, double* proj_ratio, double* sq_distance, uint8_t* hits, size_t& collected) {
+    const double v_x = gatherer.end_pos.x - gatherer.start_pos.x;
+    const double v_y = gatherer.end_pos.y - gatherer.start_pos.y;
+    const __m256d a_x = _mm256_set1_pd(gatherer.start_pos.x);
+    const __m256d a_y = _mm256_set1_pd(gatherer.start_pos.y);
+    const __m256d vv_x = _mm256_set1_pd(v_x);
+    const __m256d vv_y = _mm256_set1_pd(v_y);
+    const __m256d v_len2 = _mm256_set1_pd(v_x * v_x + v_y * v_y);
+    const __m256d width = _mm256_set1_pd(gatherer.width);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256d u_x = _mm256_sub_pd(_mm256_loadu_pd(item_x + i), a_x);
+        const __m256d u_y = _mm256_sub_pd(_mm256_loadu_pd(item_y + i), a_y);
+        const __m256d u_dot_v = _mm256_add_pd(_mm256_mul_pd(u_x, vv_x), _mm256_mul_pd(u_y, vv_y));
+        const __m256d u_len2 = _mm256_add_pd(_mm256_mul_pd(u_x, u_x), _mm256_mul_pd(u_y, u_y));
+        const __m256d proj = _mm256_div_pd(u_dot_v, v_len2);
+        const __m256d sq = _mm256_sub_pd(u_len2, _mm256_div_pd(_mm256_mul_pd(u_dot_v, u_dot_v), v_len2));
+        _mm256_storeu_pd(proj_ratio + i, proj);
+        _mm256_storeu_pd(sq_distance + i, sq);
+
+        const __m256d radius = _mm256_add_pd(width, _mm256_loadu_pd(item_width + i));
+        const __m256d hit = _mm256_and_pd(
+            _mm256_and_pd(_mm256_cmp_pd(proj, zero, _CMP_GE_OQ), _mm256_cmp_pd(proj, one, _CMP_LE_OQ)),
+            _mm256_cmp_pd(sq, _mm256_mul_pd(radius, radius), _CMP_LE_OQ));
+        const int mask = _mm256_movemask_pd(hit);
+        for (int k = 0; k < 4; ++k) {
+            hits[i + k] = (mask >> k) & 1;
+        }
+        collected += __builtin_popcount(mask);
+    }
+    return i;
+}
+#endif
+
+// Сравнение событий в порядке результата FindGatherEvents
+bool EventLess(const GatheringEvent& lhs, const GatheringEvent& rhs) {
+    return std::tie(lhs.time, lhs.gatherer_id, lhs.item_id) < std::tie(rhs.time, rhs.gatherer_id, rhs.item_id);
+}
+
+bool IsMoving(const Gatherer& gatherer) {
+    return gatherer.start_pos.x != gatherer.end_pos.x || gatherer.start_pos.y != gatherer.end_pos.y;
+}
+
+// Проверяет пару и при попадании добавляет событие
+void TryGather(const Gatherer& gatherer, size_t gatherer_id, const Item& item, size_t item_id,
+               std::vector<GatheringEvent>& events) {
+    const auto result = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, item.position);
+    if (result.IsCollected(gatherer.width + item.width)) {
+        events.push_back({item_id, gatherer_id, result.sq_distance, result.proj_ratio});
+    }
+}
+
+// Прямоугольник, вне которого собиратель не может подобрать предмет с радиусом до max_item_width.
+// TryCollectPoint считает квадрат расстояния с погрешностью порядка квадрата длины отрезка,
+// поэтому прямоугольник расширен с запасом: точка, принятая точной проверкой, всегда внутри него
+struct Bounds {
+    double min_x;
+    double min_y;
+    double max_x;
+    double max_y;
+};
+
+Bounds GatherBounds(const Gatherer& gatherer, double max_item_width) {
+    const double radius = gatherer.width + max_item_width;
+    const double length = std::abs(gatherer.end_pos.x - gatherer.start_pos.x)
+                          + std::abs(gatherer.end_pos.y - gatherer.start_pos.y);
+    const double margin = radius + 1e-6 * (length + radius) + 1e-9;
+    return {std::min(gatherer.start_pos.x, gatherer.end_pos.x) - margin,
+            std::min(gatherer.start_pos.y, gatherer.end_pos.y) - margin,
+            std::max(gatherer.start_pos.x, gatherer.end_pos.x) + margin,
+            std::max(gatherer.start_pos.y, gatherer.end_pos.y) + margin};
+}
+
+// Равномерная сетка по предметам. Предметы каждой клетки лежат подряд (упорядочены подсчётом) в структуре массивов
+// x, y, width, id, так что сетка строится за O(items + cells) без выделения памяти на клетку,
+// а кандидаты проверяются пакетно TryCollectPoints
+class ItemGrid {
+public:
+    // Число клеток ограничено, чтобы мелкая клетка на большой карте не съела память
+    static constexpr size_t CELLS_PER_ITEM = 2;
+
+    ItemGrid(std::span<const Item> items, double cell_size) {
+        Bounds bounds{items.front().position.x, items.front().position.y,
+                      items.front().position.x, items.front().position.y};
+        for (const auto& item : items) {
+            bounds.min_x = std::min(bounds.min_x, item.position.x);
+            bounds.min_y = std::min(bounds.min_y, item.position.y);
+            bounds.max_x = std::max(bounds.max_x, item.position.x);
+            bounds.max_y = std::max(bounds.max_y, item.position.y);
+        }
+        origin_x_ = bounds.min_x;
+        origin_y_ = bounds.min_y;
+        const double max_cells = static_cast<double>(CELLS_PER_ITEM * items.size() + 1);
+        cell_size_ = cell_size;
+        while (CellCount(bounds.max_x - bounds.min_x) * CellCount(bounds.max_y - bounds.min_y) > max_cells) {
+            cell_size_ *= 2;
+        }
+        inv_cell_size_ = 1 / cell_size_;
+        cols_ = static_cast<size_t>(CellCount(bounds.max_x - bounds.min_x));
+        rows_ = static_cast<size_t>(CellCount(bounds.max_y - bounds.min_y));
+
+        // Сначала cell_start_[cell] - конец клетки, затем предметы раскладываются с конца,
+        // и он сдвигается к началу клетки. Порядок предметов внутри клетки сохраняется
+        cell_start_.assign(cols_ * rows_ + 1, 0);
+        std::vector<size_t> item_cells(items.size());
+        for (size_t i = 0; i < items.size(); ++i) {
+            item_cells[i] = Cell(Column(items[i].position.x), Row(items[i].position.y));
+            ++cell_start_[item_cells[i]];
+        }
+        for (size_t cell = 1; cell < cell_start_.size(); ++cell) {
+            cell_start_[cell] += cell_start_[cell - 1];
+        }
+        x_.resize(items.size());
+        y_.resize(items.size());
+        width_.resize(items.size());
+        id_.resize(items.size());
+        for (size_t i = items.size(); i-- > 0;) {
+            const size_t k = --cell_start_[item_cells[i]];
+            x_[k] = items[i].position.x;
+            y_[k] = items[i].position.y;
+            width_[k] = items[i].width;
+            id_[k] = i;
+        }
+    }
+
+    const double* X() const noexcept {
+        return x_.data();
+    }
+    const double* Y() const noexcept {
+        return y_.data();
+    }
+    const double* Width() const noexcept {
+        return width_.data();
+    }
+    size_t Id(size_t k) const noexcept {
+        return id_[k];
+    }
+
+    // Вызывает fn(begin, end) для отрезков [begin, end) массивов сетки, в которых лежат предметы из клеток,
+    // задетых прямоугольником
+    template <typename Fn>
+    void ForEachCandidateRun(const Bounds& bounds, Fn&& fn) const {
+        const size_t col_begin = Column(bounds.min_x);
+        const size_t col_end = Column(bounds.max_x) + 1;
+        const size_t row_end = Row(bounds.max_y) + 1;
+        for (size_t row = Row(bounds.min_y); row < row_end; ++row) {
+            // Клетки одной строки идут подряд, поэтому предметы всего диапазона столбцов - один отрезок массива
+            const size_t begin = cell_start_[Cell(col_begin, row)];
+            const size_t end = cell_start_[Cell(col_end - 1, row) + 1];
+            if (begin != end) {
+                fn(begin, end);
+            }
+        }
+    }
+
+private:
+    double CellCount(double span) const {
+        return std::floor(span / cell_size_) + 1;
+    }
+
+    // Отрицательные смещения (и NaN) попадают в первую клетку, слишком большие - в последнюю.
+    // Для положительных смещений отбрасывание дробной части совпадает с floor
+    static size_t ToIndex(double offset, double inv_cell_size, size_t count) {
+        const double index = offset * inv_cell_size;
+        if (!(index > 0)) {
+            return 0;
+        }
+        return std::min(static_cast<size_t>(std::min(index, static_cast<double>(count))), count - 1);
+    }
+    size_t Column(double x) const {
+        return ToIndex(x - origin_x_, inv_cell_size_, cols_);
+    }
+    size_t Row(double y) const {
+        return ToIndex(y - origin_y_, inv_cell_size_, rows_);
+    }
+    size_t Cell(size_t col, size_t row) const {
+        return row * cols_ + col;
+    }
+
+    double origin_x_ = 0;
+    double origin_y_ = 0;
+    double cell_size_ = 1;
+    double inv_cell_size_ = 1;
+    size_t cols_ = 1;
+    size_t rows_ = 1;
+    std::vector<size_t> cell_start_;
+    std::vector<double> x_;
+    std::vector<double> y_;
+    std::vector<double> width_;
+    std::vector<size_t> id_;
+};
+
+// События собирателей moving. Каждый вызов держит свои буферы, так что разные части собирателей
+// можно обрабатывать параллельно над общей сеткой
+std::vector<GatheringEvent> CollectEvents(const ItemGrid& grid, std::span<const Gatherer> gatherers,
+                                          std::span<const size_t> moving, double max_item_width) {
+    std::vector<GatheringEvent> events;
+    // Буферы результатов пакетной проверки растут до самого длинного отрезка кандидатов
+    std::vector<double> proj_ratio;
+    std::vector<double> sq_distance;
+    std::vector<uint8_t> hits;
+    for (const size_t gatherer_id : moving) {
+        const Gatherer& gatherer = gatherers[gatherer_id];
+        grid.ForEachCandidateRun(GatherBounds(gatherer, max_item_width), [&](size_t begin, size_t end) {
+            const size_t count = end - begin;
+            if (count > hits.size()) {
+                proj_ratio.resize(count);
+                sq_distance.resize(count);
+                hits.resize(count);
+            }
+            if (TryCollectPoints(gatherer, grid.X() + begin, grid.Y() + begin, grid.Width() + begin, count,
+                                 proj_ratio.data(), sq_distance.data(), hits.data()) == 0) {
+                return;
+            }
+            for (size_t k = 0; k < count; ++k) {
+                if (hits[k]) {
+                    events.push_back({grid.Id(begin + k), gatherer_id, sq_distance[k], proj_ratio[k]});
+                }
+            }
+        });
+    }
+    std::sort(events.begin(), events.end(), EventLess);
+    return events;
+}
+
+// k-путевое слияние упорядоченных по EventLess списков. Пара (собиратель, предмет) встречается не больше одного раза,
+// поэтому порядок полный и результат совпадает с общей сортировкой
+std::vector<GatheringEvent> MergeEvents(const std::vector<std::vector<GatheringEvent>>& parts) {
+    using Cursor = std::pair<size_t, size_t>;  // часть, позиция в ней
+    auto greater = [&parts](const Cursor& lhs, const Cursor& rhs) {
+        return EventLess(parts[rhs.first][rhs.second], parts[lhs.first][lhs.second]);
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heads{greater};
+    size_t total = 0;
+    for (size_t part = 0; part < parts.size(); ++part) {
+        total += parts[part].size();
+        if (!parts[part].empty()) {
+            heads.emplace(part, 0);
+        }
+    }
+    std::vector<GatheringEvent> events;
+    events.reserve(total);
+    while (!heads.empty()) {
+        auto [part, pos] = heads.top();
+        heads.pop();
+        events.push_back(parts[part][pos]);
+        if (++pos < parts[part].size()) {
+            heads.emplace(part, pos);
+        }
+    }
+    return events;
+}
+
+// Общий на процесс пул потоков поиска: потоки создаются один раз, а не на каждый тик
+boost::asio::thread_pool& GatherPool() {
+    static boost::asio::thread_pool pool{std::max(1u, std::thread::hardware_concurrency())};
+    return pool;
+}
+
+}  // namespace
+
+size_t TryCollectPoints(const Gatherer& gatherer, const double* item_x, const double* item_y, const double* item_width,
+                        size_t count, double* proj_ratio, double* sq_distance, uint8_t* hits) {
+    assert(IsMoving(gatherer));
+    size_t done = 0;
+    size_t collected = 0;
+#ifdef COLLISION_X86_KERNELS
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if (has_avx2) {
+        done = CollectAvx2(gatherer, item_x, item_y, item_width, count, proj_ratio, sq_distance, hits, collected);
+    }
+#endif
+    return collected + CollectScalar(gatherer, item_x, item_y, item_width, done, count, proj_ratio, sq_distance, hits);
+}
+
+size_t TryCollectPointsScalar(const Gatherer& gatherer, const double* item_x, const double* item_y,
+                              const double* item_width, size_t count, double* proj_ratio, double* sq_distance,
+                              uint8_t* hits) {
+    return CollectScalar(gatherer, item_x, item_y, item_width, 0, count, proj_ratio, sq_distance, hits);
+}
+
+std::vector<GatheringEvent> FindGatherEvents(std::span<const Item> items, std::span<const Gatherer> gatherers,
+                                             size_t threads) {
+    std::vector<GatheringEvent> events;
+    if (items.empty()) {
+        return events;
+    }
+
+    double max_item_width = 0;
+    for (const auto& item : items) {
+        max_item_width = std::max(max_item_width, item.width);
+    }
+
+    std::vector<size_t> moving;
+    moving.reserve(gatherers.size());
+    // Размер клетки - средний размер области поиска собирателя: так каждый запрос задевает несколько клеток
+    double query_size = 0;
+    for (size_t g = 0; g < gatherers.size(); ++g) {
+        if (!IsMoving(gatherers[g])) {
+            continue;
+        }
+        const auto bounds = GatherBounds(gatherers[g], max_item_width);
+        query_size += std::max(bounds.max_x - bounds.min_x, bounds.max_y - bounds.min_y);
+        moving.push_back(g);
+    }
+    if (moving.empty()) {
+        return events;
+    }
+
+    const ItemGrid grid{items, query_size / static_cast<double>(moving.size())};
+    if (threads == 0) {
+        threads = moving.size() < PARALLEL_GATHERERS_THRESHOLD ? 1 : std::thread::hardware_concurrency();
+    }
+    threads = std::clamp<size_t>(threads, 1, moving.size());
+    if (threads == 1) {
+        return CollectEvents(grid, gatherers, moving, max_item_width);
+    }
+
+    // Собиратели делятся на непрерывные части. Первую часть обрабатывает вызывающий поток, остальные - пул
+    std::vector<std::vector<GatheringEvent>> parts(threads);
+    std::vector<std::exception_ptr> errors(threads);
+    auto collect_part = [&](size_t part) {
+        try {
+            const size_t begin = moving.size() * part / threads;
+            const size_t end = moving.size() * (part + 1) / threads;
+            parts[part] = CollectEvents(grid, gatherers, std::span<const size_t>{moving}.subspan(begin, end - begin),
+                                        max_item_width);
+        } catch (...) {
+            errors[part] = std::current_exception();
+        }
+    };
+    std::latch done{static_cast<std::ptrdiff_t>(threads - 1)};
+    size_t posted = 1;
+    try {
+        for (; posted < threads; ++posted) {
+            boost::asio::post(GatherPool(), [&collect_part, &done, part = posted] {
+                collect_part(part);
+                done.count_down();
+            });
+        }
+    } catch (...) {
+        // Уже поставленные задачи ссылаются на локальные переменные: до выхода с исключением их нужно дождаться.
+        // За непоставленные части счётчик уменьшается здесь же
+        done.count_down(static_cast<std::ptrdiff_t>(threads - posted));
+        done.wait();
+        throw;
+    }
+    collect_part(0);
+    done.wait();
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return MergeEvents(parts);
+}
+
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider) {
+    // Виртуальные вызовы - по одному на предмет и собирателя, дальше поиск идёт по непрерывным массивам
+    std::vector<Item> items;
+    items.reserve(provider.ItemsCount());
+    for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+        items.push_back(provider.GetItem(i));
+    }
+    std::vector<Gatherer> gatherers;
+    gatherers.reserve(provider.GatherersCount());
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        gatherers.push_back(provider.GetGatherer(g));
+    }
+    return FindGatherEvents(std::span<const Item>{items}, std::span<const Gatherer>{gatherers});
+}
+
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider) {
+    std::vector<GatheringEvent> events;
+    for (size_t g = 0; g < provider.GatherersCount(); ++g) {
+        const auto gatherer = provider.GetGatherer(g);
+        if (!IsMoving(gatherer)) {
+            continue;
+        }
+        for (size_t i = 0; i < provider.ItemsCount(); ++i) {
+            TryGather(gatherer, g, provider.GetItem(i), i, events);
+        }
+    }
+    std::sort(events.begin(), events.end(), EventLess);
+    return events;
+}
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,59 +1,118 @@
-#pragma once
-
-#include "geom.h"
-
-#include <algorithm>
-#include <vector>
-
-namespace collision_detector {
-
-struct CollectionResult {
-    bool IsCollected(double collect_radius) const {
-        return proj_ratio >= 0 && proj_ratio <= 1 && sq_distance <= collect_radius * collect_radius;
-    }
-
-    // квадрат расстояния до точки
-    double sq_distance;
-
-    // доля пройденного отрезка
-    double proj_ratio;
-};
-
-// Движемся из точки a в точку b и пытаемся подобрать точку c.
-// Эта функция реализована в уроке.
-CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c);
-
-struct Item {
-    geom::Point2D position;
-    double width;
-};
-
-struct Gatherer {
-    geom::Point2D start_pos;
-    geom::Point2D end_pos;
-    double width;
-};
-
-class ItemGathererProvider {
-protected:
-    ~ItemGathererProvider() = default;
-
-public:
-    virtual size_t ItemsCount() const = 0;
-    virtual Item GetItem(size_t idx) const = 0;
-    virtual size_t GatherersCount() const = 0;
-    virtual Gatherer GetGatherer(size_t idx) const = 0;
-};
-
-struct GatheringEvent {
-    size_t item_id;
-    size_t gatherer_id;
-    double sq_distance;
-    double time;
-};
-
-// Эту функцию вам нужно будет реализовать в соответствующем задании.
-// При проверке ваших тестов она не нужна - функция будет линковаться снаружи.
-std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
-
+#pragma once
+
+#include "geom.h"
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace collision_detector {
+
+struct CollectionResult {
+    bool IsCollected(double collect_radius) const {
+        return proj_ratio >= 0 && proj_ratio <= 1 && sq_distance <= collect_radius * collect_radius;
+    }
+
+    // квадрат расстояния до точки
+    double sq_distance;
+
+    // доля пройденного отрезка
+    double proj_ratio;
+};
+
+// Движемся из точки a в точку b и пытаемся подобрать точку c.
+// Эта функция реализована в уроке.
+CollectionResult TryCollectPoint(geom::Point2D a, geom::Point2D b, geom::Point2D c);
+
+struct Item {
+    geom::Point2D position;
+    double width;
+};
+
+struct Gatherer {
+    geom::Point2D start_pos;
+    geom::Point2D end_pos;
+    double width;
+};
+
+// Пакетный вариант TryCollectPoint: один собиратель и count предметов, заданных структурой массивов
+// item_x, item_y, item_width. Для каждого предмета записывает proj_ratio и sq_distance, а в hits - 1, если предмет
+// собран (IsCollected с радиусом gatherer.width + item_width[i]), и 0 иначе. Возвращает число собранных предметов.
+// На x86 используется AVX2, если он есть у процессора, иначе скалярный цикл. Результат совпадает
+// с TryCollectPoint бит в бит
+size_t TryCollectPoints(const Gatherer& gatherer, const double* item_x, const double* item_y, const double* item_width,
+                        size_t count, double* proj_ratio, double* sq_distance, uint8_t* hits);
+
+// То же только скалярным циклом, для сравнения в бенчмарках и тестах
+size_t TryCollectPointsScalar(const Gatherer& gatherer, const double* item_x, const double* item_y,
+                              const double* item_width, size_t count, double* proj_ratio, double* sq_distance,
+                              uint8_t* hits);
+
+class ItemGathererProvider {
+protected:
+    ~ItemGathererProvider() = default;
+
+public:
+    virtual size_t ItemsCount() const = 0;
+    virtual Item GetItem(size_t idx) const = 0;
+    virtual size_t GatherersCount() const = 0;
+    virtual Gatherer GetGatherer(size_t idx) const = 0;
+};
+
+struct GatheringEvent {
+    size_t item_id;
+    size_t gatherer_id;
+    double sq_distance;
+    double time;
+};
+
+// Поставщик, который отдаёт предметы и собирателей целыми непрерывными массивами. item_id и gatherer_id событий -
+// индексы в этих массивах
+template <typename Provider>
+concept BulkItemGathererProvider = requires(const Provider& provider) {
+    { provider.Items() } -> std::convertible_to<std::span<const Item>>;
+    { provider.Gatherers() } -> std::convertible_to<std::span<const Gatherer>>;
+};
+
+// Простейший BulkItemGathererProvider поверх готовых массивов
+struct ItemGathererSpans {
+    std::span<const Item> items;
+    std::span<const Gatherer> gatherers;
+
+    std::span<const Item> Items() const noexcept {
+        return items;
+    }
+    std::span<const Gatherer> Gatherers() const noexcept {
+        return gatherers;
+    }
+};
+
+// Начиная с такого числа движущихся собирателей поиск по умолчанию делится между потоками
+inline constexpr size_t PARALLEL_GATHERERS_THRESHOLD = 2048;
+
+// События сбора за тик, упорядоченные по времени, при равном времени - по gatherer_id, затем по item_id.
+// Собиратели, которые не сдвинулись, ничего не собирают.
+// Кандидаты в пары отбираются равномерной сеткой по предметам: каждый собиратель проверяет только предметы
+// из клеток, которые задевает прямоугольник его отрезка, расширенный на радиус сбора.
+// threads - на сколько частей делятся собиратели: 1 - всё в вызывающем потоке, 0 - выбрать по
+// PARALLEL_GATHERERS_THRESHOLD и числу ядер. Части обрабатываются общим пулом потоков, их события сливаются
+// в тот же порядок, так что результат от threads не зависит
+std::vector<GatheringEvent> FindGatherEvents(std::span<const Item> items, std::span<const Gatherer> gatherers,
+                                             size_t threads = 0);
+
+// Поиск прямо по массивам поставщика, без копирования и виртуальных вызовов
+template <BulkItemGathererProvider Provider>
+std::vector<GatheringEvent> FindGatherEvents(const Provider& provider) {
+    return FindGatherEvents(std::span<const Item>{provider.Items()}, std::span<const Gatherer>{provider.Gatherers()});
+}
+
+// Адаптер для виртуального интерфейса: предметы и собиратели один раз копируются в массивы
+std::vector<GatheringEvent> FindGatherEvents(const ItemGathererProvider& provider);
+
+// То же прямым перебором всех пар (собиратель, предмет) за O(items × gatherers). Эталон для тестов и бенчмарков
+std::vector<GatheringEvent> FindGatherEventsBruteForce(const ItemGathererProvider& provider);
+
 }  // namespace collision_detector
\ No newline at end of file
@@ -1,5 +1,233 @@
-#define _USE_MATH_DEFINES
-
-#include "../src/collision_detector.h"
-
-// Напишите здесь тесты для функции collision_detector::FindGatherEvents
\ No newline at end of file
+#define _USE_MATH_DEFINES
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <random>
+#include <vector>
+
+#include "../src/collision_detector.h"
+
+using namespace collision_detector;
+using Catch::Matchers::WithinAbs;
+
+namespace {
+
+class VectorProvider : public ItemGathererProvider {
+public:
+    VectorProvider(std::vector<Item> items, std::vector<Gatherer> gatherers)
+        : items_(std::move(items))
+        , gatherers_(std::move(gatherers)) {
+    }
+
+    size_t ItemsCount() const override {
+        return items_.size();
+    }
+    Item GetItem(size_t idx) const override {
+        return items_.at(idx);
+    }
+    size_t GatherersCount() const override {
+        return gatherers_.size();
+    }
+    Gatherer GetGatherer(size_t idx) const override {
+        return gatherers_.at(idx);
+    }
+
+    ItemGathererSpans Spans() const noexcept {
+        return {items_, gatherers_};
+    }
+
+private:
+    std::vector<Item> items_;
+    std::vector<Gatherer> gatherers_;
+};
+
+// Случайные предметы и собиратели на квадрате side × side. Собиратели двигаются по осям, как собаки по дорогам,
+// но каждый пятый - наискосок
+VectorProvider MakeRandomProvider(std::mt19937& gen, size_t items_count, size_t gatherers_count, double side) {
+    std::uniform_real_distribution<double> coord{0.0, side};
+    std::uniform_real_distribution<double> step{-side / 10, side / 10};
+    std::uniform_real_distribution<double> width{0.0, 1.0};
+    std::vector<Item> items;
+    for (size_t i = 0; i < items_count; ++i) {
+        items.push_back({{coord(gen), coord(gen)}, width(gen)});
+    }
+    std::vector<Gatherer> gatherers;
+    for (size_t g = 0; g < gatherers_count; ++g) {
+        geom::Point2D start{coord(gen), coord(gen)};
+        geom::Point2D end = start;
+        switch (g % 5) {
+        case 0: end.x += step(gen); break;
+        case 1: end.y += step(gen); break;
+        case 2: end.x += step(gen); end.y += step(gen); break;
+        case 3: end.x += step(gen); break;
+        default: break;  // стоит на месте
+        }
+        gatherers.push_back({start, end, width(gen)});
+    }
+    return VectorProvider{std::move(items), std::move(gatherers)};
+}
+
+void RequireSameEvents(const std::vector<GatheringEvent>& actual, const std::vector<GatheringEvent>& expected) {
+    REQUIRE(actual.size() == expected.size());
+    for (size_t i = 0; i < actual.size(); ++i) {
+        INFO("event " << i);
+        CHECK(actual[i].item_id == expected[i].item_id);
+        CHECK(actual[i].gatherer_id == expected[i].gatherer_id);
+        CHECK(actual[i].sq_distance == expected[i].sq_distance);
+        CHECK(actual[i].time == expected[i].time);
+    }
+}
+
+}  // namespace
+
+SCENARIO("Batch point collection") {
+    GIVEN("a gatherer and random items in structure-of-arrays form") {
+        std::mt19937 gen{7};
+        std::uniform_real_distribution<double> coord{-20.0, 20.0};
+        std::uniform_real_distribution<double> width{0.0, 3.0};
+        const Gatherer gatherer{{-5, 1}, {7, -2}, 0.6};
+        // Нечётное число предметов, чтобы проверить и хвост за векторной частью
+        constexpr size_t COUNT = 1003;
+        std::vector<double> xs, ys, widths;
+        for (size_t i = 0; i < COUNT; ++i) {
+            xs.push_back(coord(gen));
+            ys.push_back(coord(gen));
+            widths.push_back(width(gen));
+        }
+
+        THEN("the vectorized and scalar versions match TryCollectPoint bit for bit") {
+            std::vector<double> proj(COUNT), sq(COUNT), proj_scalar(COUNT), sq_scalar(COUNT);
+            std::vector<uint8_t> hits(COUNT), hits_scalar(COUNT);
+            const size_t collected = TryCollectPoints(gatherer, xs.data(), ys.data(), widths.data(), COUNT,
+                                                      proj.data(), sq.data(), hits.data());
+            const size_t collected_scalar = TryCollectPointsScalar(gatherer, xs.data(), ys.data(), widths.data(),
+                                                                   COUNT, proj_scalar.data(), sq_scalar.data(),
+                                                                   hits_scalar.data());
+            size_t expected_collected = 0;
+            for (size_t i = 0; i < COUNT; ++i) {
+                INFO("item " << i);
+                const auto expected = TryCollectPoint(gatherer.start_pos, gatherer.end_pos, {xs[i], ys[i]});
+                const bool expected_hit = expected.IsCollected(gatherer.width + widths[i]);
+                expected_collected += expected_hit;
+                CHECK(proj[i] == expected.proj_ratio);
+                CHECK(sq[i] == expected.sq_distance);
+                CHECK(bool(hits[i]) == expected_hit);
+                CHECK(proj_scalar[i] == expected.proj_ratio);
+                CHECK(sq_scalar[i] == expected.sq_distance);
+                CHECK(bool(hits_scalar[i]) == expected_hit);
+            }
+            CHECK(expected_collected > 0);
+            CHECK(collected == expected_collected);
+            CHECK(collected_scalar == expected_collected);
+        }
+    }
+}
+
+SCENARIO("Gather events") {
+    GIVEN("a gatherer moving along the x axis") {
+        const Gatherer gatherer{{0, 0}, {10, 0}, 0.6};
+
+        WHEN("there are no items") {
+            VectorProvider provider{{}, {gatherer}};
+            THEN("no events are found") {
+                CHECK(FindGatherEvents(provider).empty());
+            }
+        }
+
+        WHEN("an item lies near the path") {
+            VectorProvider provider{{{{5, 0.5}, 0.1}}, {gatherer}};
+            THEN("the item is gathered halfway") {
+                const auto events = FindGatherEvents(provider);
+                REQUIRE(events.size() == 1);
+                CHECK(events[0].item_id == 0);
+                CHECK(events[0].gatherer_id == 0);
+                CHECK_THAT(events[0].time, WithinAbs(0.5, 1e-10));
+                CHECK_THAT(events[0].sq_distance, WithinAbs(0.25, 1e-10));
+            }
+        }
+
+        WHEN("an item is farther than the sum of widths") {
+            VectorProvider provider{{{{5, 0.8}, 0.1}}, {gatherer}};
+            THEN("it is not gathered") {
+                CHECK(FindGatherEvents(provider).empty());
+            }
+        }
+
+        WHEN("an item lies before the start or after the end of the path") {
+            VectorProvider provider{{{{-0.5, 0}, 0.1}, {{10.5, 0}, 0.1}}, {gatherer}};
+            THEN("it is not gathered") {
+                CHECK(FindGatherEvents(provider).empty());
+            }
+        }
+
+        WHEN("several items lie on the path") {
+            VectorProvider provider{{{{9, 0}, 0}, {{1, 0}, 0}, {{4, 0.1}, 0}}, {gatherer}};
+            THEN("events are ordered by time") {
+                const auto events = FindGatherEvents(provider);
+                REQUIRE(events.size() == 3);
+                CHECK(events[0].item_id == 1);
+                CHECK(events[1].item_id == 2);
+                CHECK(events[2].item_id == 0);
+            }
+        }
+    }
+
+    GIVEN("two gatherers passing the same item at the same time") {
+        VectorProvider provider{{{{5, 0}, 0}}, {{{0, 1}, {10, 1}, 1}, {{0, -1}, {10, -1}, 1}}};
+        THEN("both gather it, ordered by gatherer id") {
+            const auto events = FindGatherEvents(provider);
+            REQUIRE(events.size() == 2);
+            CHECK(events[0].gatherer_id == 0);
+            CHECK(events[1].gatherer_id == 1);
+        }
+    }
+
+    GIVEN("a gatherer that does not move") {
+        VectorProvider provider{{{{0, 0}, 1}}, {{{0, 0}, {0, 0}, 1}}};
+        THEN("it gathers nothing") {
+            CHECK(FindGatherEvents(provider).empty());
+        }
+    }
+
+    GIVEN("random items and gatherers") {
+        std::mt19937 gen{20240101};
+        THEN("the virtual and bulk providers match brute force at any density") {
+            for (const double side : {10.0, 100.0, 1000.0}) {
+                for (int round = 0; round < 5; ++round) {
+                    INFO("side " << side << ", round " << round);
+                    const auto provider = MakeRandomProvider(gen, 500, 100, side);
+                    const auto expected = FindGatherEventsBruteForce(provider);
+                    RequireSameEvents(FindGatherEvents(provider), expected);
+                    RequireSameEvents(FindGatherEvents(provider.Spans()), expected);
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Parallel gather events") {
+    GIVEN("random items and gatherers") {
+        std::mt19937 gen{42};
+        THEN("splitting gatherers between threads gives the serial result") {
+            for (const size_t gatherers : {1, 3, 50, 500}) {
+                for (const double side : {10.0, 300.0}) {
+                    const auto provider = MakeRandomProvider(gen, 2000, gatherers, side);
+                    const auto spans = provider.Spans();
+                    const auto serial = FindGatherEvents(spans.items, spans.gatherers, 1);
+                    for (const size_t threads : {2, 3, 8}) {
+                        INFO("gatherers " << gatherers << ", side " << side << ", threads " << threads);
+                        RequireSameEvents(FindGatherEvents(spans.items, spans.gatherers, threads), serial);
+                    }
+                }
+            }
+        }
+
+        THEN("above the threshold the default search gives the serial result") {
+            const auto provider = MakeRandomProvider(gen, 5000, PARALLEL_GATHERERS_THRESHOLD * 2, 200.0);
+            const auto spans = provider.Spans();
+            RequireSameEvents(FindGatherEvents(spans.items, spans.gatherers),
+                              FindGatherEvents(spans.items, spans.gatherers, 1));
+        }
+    }
+}